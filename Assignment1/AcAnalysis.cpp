@@ -0,0 +1,87 @@
+// AcAnalysis.cpp - Phasor solve of the series loop over a frequency list
+
+#include "AcAnalysis.h"
+#include "Component.h"
+#include "ThreadPool.h" // Work-stealing pool
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+
+//------------------------------------------------------------------------------
+AcAnalysis::AcAnalysis(const vector<Component*>& series, double peakVoltage)
+    : parts(series.begin(), series.end()), Vpeak(peakVoltage) {
+}
+
+//------------------------------------------------------------------------------
+vector<double> AcAnalysis::LogSpace(double fStart, double fStop, size_t points) {
+    vector<double> f(points);
+    double ratio = log(fStop / fStart);
+    for (size_t i = 0; i < points; ++i)
+        f[i] = points > 1 ? fStart * exp(ratio * double(i) / double(points - 1)) : fStart;
+    return f;
+}
+
+//------------------------------------------------------------------------------
+void AcAnalysis::Solve(size_t first, size_t last) {
+    size_t stride = parts.size() + 1;
+    for (size_t i = first; i < last; ++i) {
+        double omega = 2.0 * PI * freqs[i];
+        complex<double>* out = &values[i * stride];
+        complex<double> total = 0.0;
+        for (size_t k = 0; k < parts.size(); ++k) {
+            out[1 + k] = parts[k]->GetImpedance(omega);
+            total += out[1 + k];
+        }
+        out[0] = Vpeak / total;
+        for (size_t k = 0; k < parts.size(); ++k) out[1 + k] *= out[0];
+    }
+}
+
+//------------------------------------------------------------------------------
+// Contiguous blocks of frequencies, a few per worker so stealing can balance them
+void AcAnalysis::Run(const vector<double>& frequencies, unsigned threads) {
+    freqs = frequencies;
+    values.assign(freqs.size() * (parts.size() + 1), 0.0);
+
+    ThreadPool pool(threads);
+    size_t blocks = min(freqs.size(), size_t(pool.size()) * 4);
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t first = freqs.size() * b / blocks, last = freqs.size() * (b + 1) / blocks;
+        pool.submit([this, first, last] { Solve(first, last); });
+    }
+    pool.wait();
+}
+
+//------------------------------------------------------------------------------
+// Bode data in fixed-width columns: for the current its
+// magnitude (A) and phase (degrees), for each element voltage its magnitude
+// (V), gain relative to the source (dB) and phase (degrees)
+void AcAnalysis::WriteBode(const string& filename) const {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open output file " << filename << endl;
+        exit(1);
+    }
+
+    auto degrees = [](complex<double> z) { return arg(z) * 180.0 / PI; };
+    out << setw(14) << "Freq" << setw(14) << "I" << setw(14) << "I_ph";
+    for (auto& c : parts)
+        out << setw(14) << c->GetName() << setw(14) << c->GetName() + "_dB" << setw(14) << c->GetName() + "_ph";
+    out << '\n';
+    for (size_t i = 0; i < freqs.size(); ++i) {
+        out << setw(14) << freqs[i] << setw(14) << abs(Current(i)) << setw(14) << degrees(Current(i));
+        for (size_t k = 0; k < parts.size(); ++k) {
+            complex<double> v = Voltage(i, k);
+            out << setw(14) << abs(v) << setw(14) << 20.0 * log10(abs(v) / Vpeak) << setw(14) << degrees(v);
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef _ACANALYSISH
+#define _ACANALYSISH
+
+#include <complex>
+#include <string>
+#include <vector>
+
+class Component; // Series element, see Component.h
+
+// Small-signal AC analysis of the series loop. Instead of running a transient
+// per frequency, every element is replaced by its phasor impedance
+// (Component::GetImpedance) and the loop is solved directly:
+//   I = Vpeak / sum(Z),  V_k = I * Z_k
+// Frequency points are independent and are split across the thread pool.
+class AcAnalysis {
+    std::vector<const Component*> parts; // Series elements, not owned
+    double Vpeak; // Source phasor amplitude (V), phase 0
+    std::vector<double> freqs; // Analysis frequencies (Hz)
+    std::vector<std::complex<double>> values; // Per frequency: current, then each element voltage
+
+    void Solve(size_t first, size_t last); // Fill values for freqs[first, last)
+
+public:
+    AcAnalysis(const std::vector<Component*>& series, double peakVoltage);
+
+    // points frequencies spaced evenly on a log scale from fStart to fStop
+    static std::vector<double> LogSpace(double fStart, double fStop, size_t points);
+
+    void Run(const std::vector<double>& frequencies, unsigned threads); // 0 threads = all cores
+    void WriteBode(const std::string& filename) const; // Magnitude and phase per frequency
+
+    size_t Count() const { return freqs.size(); } // Frequency points solved
+    double Frequency(size_t i) const { return freqs[i]; }
+    std::complex<double> Current(size_t i) const { return values[i * (parts.size() + 1)]; }
+    std::complex<double> Voltage(size_t i, size_t part) const { return values[i * (parts.size() + 1) + 1 + part]; }
+};
+
+#endif // _ACANALYSISH
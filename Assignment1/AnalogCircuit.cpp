@@ -1,17 +1,19 @@
-// AnalogCircuit.cpp - Implementation file for ANASIM Analog Circuit Simulator
+// AnalogCircuit.cpp - Implementation file for the ANASIM simulation core
 
 #define _USE_MATH_DEFINES
 #include "AnalogCircuit.h" // Include the header file for the AnalogCircuit class
 #include "Capacitor.h" // Include the header file for the Capacitor class
+#include "Diode.h" // Include the header file for the Diode class
 #include "Inductor.h" // Include the header file for the Inductor class
+#include "MatrixExponential.h" // Exact discretisation of the RLC loop
 #include "Resistor.h" // Include the header file for the Resistor class
+#include "SaturableInductor.h" // Include the header file for the SaturableInductor class
+#include "WaveformAnalytics.h" // Online metrics fed by runStep()
 
 #include <cmath> // For math functions like sin, fabs
+#include <cstdint>
 #include <cstdlib> // For exit()
-#include <GL/glut.h> // GLUT for windowing and input
-#include <Windows.h> // Windows API for message handling
-#undef max  // Undefine Windows max macro to avoid conflict with std::max
-#undef min  // Undefine Windows min macro as well
+#include <filesystem> // For resize_file when resuming a data file
 #include <iomanip>
 #include <iostream>
 #include <fstream>
@@ -22,179 +24,52 @@
 
 using namespace std;
 
-// Global variables definition
-int windowWidth = 1000; // Width of the OpenGL window
-int windowHeight = 600; //  Height of the OpenGL window
-double scalingFactor = 1.0;     // Scaling factor for drawing components
-
-// Global voltage history storage 
-vector<vector<double>> voltageHistory(3);
-vector<double> inputHistory;  // Store input voltage history for white trace
-vector<float> timeHistory; // Store time history
-
-// Global simulation state
-static bool globalSimulationRunning = false; // True while any simulation is active
-static bool globalSimulationComplete = false; //    True when simulation has finished
-AnalogCircuit* currentCircuit = nullptr; // Pointer to current circuit
-
-
-// Windows message pump for responsive GUI
-static inline void PumpMessages() {
-    MSG msg;
-    while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
-    }
-}
-
-//  ------------------------------------------------------------------------------
-void start() {
-	// Display simulation information
-    cout << "ANASIM - Analog Circuit Simulator" << endl;
-    cout << "=================================" << endl;
-
-    // Defaults
-	double R = 20.0; // Ohms
-	double L = 0.05; // Henries
-	double C = 0.00007; // Farads
-	double freq = 50.0; // Hz
-	double Vpeak = 10.0; // Volts
-	double simTime = 0.1; // seconds
-
-    // Get user input for circuit parameters with defaults on blank/empty input
-    cout << "Enter resistor value (ohms) [default " << R << "]: "; 
-	string inputLine; // input line
-    getline(cin, inputLine);
-    if (inputLine.empty() || !(istringstream(inputLine) >> R)) {
-        R = 20.0;
-        cout << "Using default: " << R << endl;
-    }
-    cout << "Enter inductor value (henries) [default " << L << "]: ";
-	getline(cin, inputLine); // input line
-    if (inputLine.empty() || !(istringstream(inputLine) >> L)) {
-        L = 0.05;
-        cout << "Using default: " << L << endl;
-    }
-    cout << "Enter capacitor value (farads) [default " << C << "]: ";
-	getline(cin, inputLine); // input line
-    if (inputLine.empty() || !(istringstream(inputLine) >> C)) {
-        C = 0.00007;
-        cout << "Using default: " << C << endl;
-    }
-    cout << "Enter frequency (Hz) [default " << freq << "]: ";
-	getline(cin, inputLine); // input line
-    if (inputLine.empty() || !(istringstream(inputLine) >> freq)) {
-        freq = 50.0;
-        cout << "Using default: " << freq << endl;
-    }
-    cout << "Enter peak voltage (V) [default " << Vpeak << "]: ";
-	getline(cin, inputLine); // input line
-    if (inputLine.empty() || !(istringstream(inputLine) >> Vpeak)) {
-        Vpeak = 10.0;
-        cout << "Using default: " << Vpeak << endl;
-    }
-    cout << "Enter simulation time (seconds) [default " << simTime << "]: ";
-	getline(cin, inputLine); // input line
-    if (inputLine.empty() || !(istringstream(inputLine) >> simTime)) {
-        simTime = 0.1;
-        cout << "Using default: " << simTime << endl;
-    }
-
-	// Display chosen parameters
-    cout << "\nStarting simulation with:" << endl;
-    cout << "R = " << R << " ohms, L = " << L << " H, C = " << C << " F" << endl;
-    cout << "Frequency = " << freq << " Hz, Vpeak = " << Vpeak << " V" << endl;
-    cout << "Simulation time = " << simTime << " seconds" << endl;
-
-	// Create the circuit instance
-    AnalogCircuit* circuit = new AnalogCircuit("RLC.dat", R, L, C, freq, Vpeak, simTime);
-    currentCircuit = circuit;
-    circuit->run();
-}
-
 //------------------------------------------------------------------------------
-// Display method
-void AnalogCircuit::display(float /*R*/, float /*G*/, float /*B*/) {
-    // No-op: real-time drawing moved to display callback in main
-}
-
-//------------------------------------------------------------------------------
-// Draw background grid
-void AnalogCircuit::drawGrid() {
-    // Light gray grid (darker for black background, but commented out in display)
-    glColor3f(0.3f, 0.3f, 0.3f);
-    glBegin(GL_LINES);
-
-    // Vertical lines
-    for (int x = 50; x < windowWidth; x += 50) {
-        glVertex2f((float)x, 0.0f);
-        glVertex2f((float)x, (float)windowHeight);
-    }
-
-    // Horizontal lines  
-    for (int y = 50; y < windowHeight; y += 50) {
-        glVertex2f(0.0f, (float)y);
-        glVertex2f((float)windowWidth, (float)y);
-    }
-
-    glEnd();
-}
-
-//------------------------------------------------------------------------------
-void AnalogCircuit::drawAxes() {
-    // WHITE axes to show on black background
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glLineWidth(2.0f);
-    glBegin(GL_LINES);
-
-    // Y-axis
-    glVertex2f(50.0f, 0.0f);
-    glVertex2f(50.0f, (float)windowHeight);
-
-    // X-axis
-    glVertex2f(0.0f, (float)windowHeight / 2.0f);
-    glVertex2f((float)windowWidth, (float)windowHeight / 2.0f);
-
-    glEnd();
-    glLineWidth(1.0f);
-
-    // Labels 
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2f(30.0f, (float)windowHeight / 2.0f - 15.0f);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"0V");
-
-    glRasterPos2f(30.0f, (float)windowHeight - 30.0f);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"+V");
-
-    glRasterPos2f(30.0f, 30.0f);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"-V");
-
-    glRasterPos2f((float)windowWidth - 50.0f, (float)windowHeight / 2.0f - 15.0f);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"Time");
-}
-
-//------------------------------------------------------------------------------
-// Draw voltage history
-void drawVoltageHistory() {
-    // This is now handled by real-time display
-}
-
-//------------------------------------------------------------------------------
-// Destructor to clean up components and close file
+// Constructor creates the series RLC components and opens the output file
 AnalogCircuit::AnalogCircuit(string filename, double R, double L, double C,
     double frequency, double peakVoltage, double simTime)
-    : R_val(R), L_val(L), C_val(C), freq(frequency), Vpeak(peakVoltage), timeMax(simTime) {
-
-    fout.open(filename);
-    if (!fout.is_open()) {
-        cerr << "Error: Could not open output file " << filename << endl;
-        exit(1);
+    : R_val(R), L_val(L), C_val(C), freq(frequency),
+    // Create components with user values and updated names
+    rlc(Resistor(R, 1.0f, 0.0f, 0.0f, "R1"),       // Red
+        Capacitor(C, 0.0f, 1.0f, 0.0f, "C1"),      // Green
+        Inductor(L, 0.0f, 0.0f, 1.0f, "L1")),      // Blue
+    Vpeak(peakVoltage), timeMax(simTime) {
+
+    // An empty filename runs without file output (sweeps, benchmarks)
+    dataFile = filename;
+    checkpointEvery = 0;
+    if (!filename.empty()) {
+        if (!fout.Open(filename)) {
+            cerr << "Error: Could not open output file " << filename << endl;
+            exit(1);
+        }
     }
 
     // Set simulation parameters
     T = 0.0001;  // Reasonable time step
     tolerance = 0.001;
     I = 0.0;
+    solver = SOLVER_DIRECT;
+    verbose = true;
+    messagePump = nullptr;
+    cutoffTime = 0.6 * simTime;
+    stimulus = nullptr;
+    exactStep = 0.0;
+    recording = true;
+    analytics = nullptr;
+
+    // Fixed step unless SetAdaptive() is called
+    adaptive = false;
+    relTol = 1e-3;
+    absTol = 1e-6;
+    minStep = maxStep = firstStep = prevStep = T;
+    history[0][0] = history[0][1] = history[1][0] = history[1][1] = 0.0;
+    peak[0] = peak[1] = 0.0;
+    historyCount = 0;
+    onBreakpoint = false;
+    rejectedSteps = 0;
+    solverIterations = 0;
+    maxStepIterations = 0;
 
     // Simulation state
     simulationRunning = false;
@@ -202,15 +77,9 @@ AnalogCircuit::AnalogCircuit(string filename, double R, double L, double C,
     currentTime = 0.0;
     stepCount = 0;
 
-    // FIXED: Initialize voltage history properly
-    for (auto& vec : voltageHistory) vec.clear();
-    timeHistory.clear();
-    inputHistory.clear();
+    lastSample = Sample{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 
-    // Create components with user values and updated names
-    components.push_back(new Resistor(R_val, 1.0f, 0.0f, 0.0f, "R1"));      // Red
-    components.push_back(new Capacitor(C_val, 0.0f, 1.0f, 0.0f, "C1"));     // Green
-    components.push_back(new Inductor(L_val, 0.0f, 0.0f, 1.0f, "L1"));      // Blue
+    rlc.Pointers(components);
 }
 
 //------------------------------------------------------------------------------
@@ -223,12 +92,12 @@ void AnalogCircuit::CostFunctionV(double& current, double voltage, double timest
 
     // Heuristic iteration to minimize cost function
     do {
-        PumpMessages();
+        if (messagePump) messagePump();
         iterations++;
 
         // Calculate sum of component voltages for current guess
-        double sumV = 0.0;
-        for (auto& c : components) {
+        double sumV = rlc.Voltage(I1, timestep);
+        for (auto& c : extras) {
             sumV += c->GetVoltage(I1, timestep);
         }
 
@@ -238,6 +107,7 @@ void AnalogCircuit::CostFunctionV(double& current, double voltage, double timest
         // Adjust step size if not making progress
         if ((fabs(J0 - J1) != (J0 - J1)) || J0 == J1) {
             alpha /= 2.0;
+            stats.Count(STAT_ALPHA_HALVED);
         }
 
         // Adjust current guess based on cost
@@ -250,10 +120,12 @@ void AnalogCircuit::CostFunctionV(double& current, double voltage, double timest
         // Reset alpha if it becomes too small
         if (alpha < tolerance / 1e6) {
             alpha = 0.01; // Reset to initial value
+            stats.Count(STAT_ALPHA_RESET);
         }
 
         // Safety check to prevent infinite loops
         if (iterations > maxIterations) {
+            stats.Count(STAT_NON_CONVERGED);
             if (fabs(J1) > 0.1) {
                 cout << "Warning: Max iterations reached. Error: " << J1 << endl;
             }
@@ -262,9 +134,215 @@ void AnalogCircuit::CostFunctionV(double& current, double voltage, double timest
 
     } while (fabs(J1) > tolerance);
 
+    stats.iterations.Add(iterations);
+    solverIterations += iterations;
+    maxStepIterations = max(maxStepIterations, iterations);
     current = I1;
 }
 
+//------------------------------------------------------------------------------
+// Direct implicit solve: every component is V = Req * I + Veq for this step,
+// so the series loop gives I = (V - sum(Veq)) / sum(Req) in one pass
+void AnalogCircuit::SolveDirect(double& current, double voltage, double timestep) {
+    double sumR, sumV;
+    rlc.Companion(timestep, sumR, sumV);
+    for (auto& c : extras) {
+        double Req, Veq;
+        c->GetCompanion(timestep, Req, Veq);
+        sumR += Req;
+        sumV += Veq;
+    }
+    current = (voltage - sumV) / sumR;
+}
+
+//------------------------------------------------------------------------------
+// Newton-Raphson on F(I) = sum(V_k(I)) - V. Each component supplies its own
+// voltage and slope, so the Jacobian is the sum of the slopes. Components may
+// shorten the step (voltage limiting), and a step that does not reduce |F| is
+// halved (damping).
+void AnalogCircuit::SolveNewton(double& current, double voltage, double timestep) {
+    const int maxIterations = 50;
+    auto residual = [&](double I1, double& J) {
+        double sumV = 0.0;
+        J = 0.0;
+        for (auto& c : components) {
+            double V, dVdI;
+            c->GetVoltageAndSlope(I1, timestep, V, dVdI);
+            sumV += V;
+            J += dVdI;
+        }
+        return sumV - voltage;
+    };
+
+    double I1 = current, J;
+    double F = residual(I1, J);
+    double scale = fabs(voltage) + 1.0;
+    int iterations = 0;
+    while (iterations < maxIterations && fabs(F) > 1e-12 * scale) {
+        iterations++;
+        double J2, I2 = I1 - F / J;
+        for (auto& c : components) I2 = c->LimitCurrent(I1, I2);
+        double step = I2 - I1;
+        double F2 = residual(I2, J2);
+        for (int k = 0; k < 20 && !(fabs(F2) < fabs(F)); ++k) {
+            step *= 0.5;
+            I2 = I1 + step;
+            F2 = residual(I2, J2);
+        }
+        I1 = I2;
+        F = F2;
+        J = J2;
+        if (fabs(step) <= 1e-12 * fabs(I1) + 1e-15) break;
+    }
+    if (iterations >= maxIterations) {
+        stats.Count(STAT_NON_CONVERGED);
+        if (verbose) cout << "Warning: Newton did not converge at t=" << currentTime << ". Error: " << F << endl;
+    }
+
+    stats.iterations.Add(iterations);
+    solverIterations += iterations;
+    maxStepIterations = max(maxStepIterations, iterations);
+    current = I1;
+}
+
+//------------------------------------------------------------------------------
+// Split [from, to] where the source switches (t = 0 and the cutoff); the
+// oscillator states are loaded from the waveform at the start of each piece,
+// or zeroed while the source is off
+void AnalogCircuit::SolveExact(double from, double to, double& vC, double& iL) {
+    double z[4];
+    GetState(z[0], z[1]);
+    double t = from;
+    auto advance = [&](double until, bool on) {
+        double h = until - t;
+        if (h <= 0.0) return;
+        if (h != exactStep) {
+            double w = 2.0 * M_PI * freq;
+            vector<double> M{
+                0.0,           h / C_val,           0.0,       0.0,
+                -h / L_val,    -h * R_val / L_val,  h / L_val, 0.0,
+                0.0,           0.0,                 0.0,       h * w,
+                0.0,           0.0,                 -h * w,    0.0 };
+            MatrixExponential(M, 4, exactPhi);
+            exactStep = h;
+        }
+        z[2] = on ? Vpeak * sin(2.0 * M_PI * freq * t) : 0.0;
+        z[3] = on ? Vpeak * cos(2.0 * M_PI * freq * t) : 0.0;
+        double next[4];
+        for (int i = 0; i < 4; ++i)
+            next[i] = exactPhi[i * 4] * z[0] + exactPhi[i * 4 + 1] * z[1] + exactPhi[i * 4 + 2] * z[2] + exactPhi[i * 4 + 3] * z[3];
+        for (int i = 0; i < 4; ++i) z[i] = next[i];
+        t = until;
+    };
+    advance(min(to, 0.0), false);
+    advance(min(to, cutoffTime), true);
+    advance(to, false);
+    vC = z[0];
+    iL = z[1];
+}
+
+//------------------------------------------------------------------------------
+void AnalogCircuit::AddComponent(Component* c) {
+    extras.push_back(c);
+    components.push_back(c);
+}
+
+//------------------------------------------------------------------------------
+// Sinusoidal voltage for the first part, then 0V (as in sample) - this causes decay
+double AnalogCircuit::SourceVoltage(double t) const {
+    if (stimulus) return stimulus->Value(t);
+    return (t < cutoffTime) ? Vpeak * sin(2.0 * M_PI * freq * t) : 0.0;
+}
+
+//------------------------------------------------------------------------------
+double AnalogCircuit::NextBreakpoint() const {
+    if (stimulus) return stimulus->NextBreakpoint(currentTime);
+    return currentTime < cutoffTime ? cutoffTime : HUGE_VAL;
+}
+
+//------------------------------------------------------------------------------
+void AnalogCircuit::SetStimulus(Stimulus* s) {
+    delete stimulus;
+    stimulus = s;
+}
+
+//------------------------------------------------------------------------------
+void AnalogCircuit::GetState(double& vC, double& iL) const {
+    vC = rlc.Get<1>().GetStoredVoltage();
+    iL = rlc.Get<2>().GetCurrent();
+}
+
+//------------------------------------------------------------------------------
+// Extra series elements carry the loop current too, so they are committed to iL
+void AnalogCircuit::Reset(double vC, double iL) {
+    rlc.Get<1>().SetVoltage(vC);
+    rlc.Get<2>().SetCurrent(iL);
+    for (auto& c : extras) c->Commit(iL, T);
+    I = iL;
+    currentTime = 0.0;
+    stepCount = 0;
+    historyCount = 0;
+    onBreakpoint = false;
+    simulationComplete = false;
+}
+
+//------------------------------------------------------------------------------
+void AnalogCircuit::SetAdaptive(bool on, double rel, double abs, double maxStepSize) {
+    adaptive = on;
+    relTol = rel;
+    absTol = abs;
+    maxStep = maxStepSize > 0.0 ? maxStepSize : timeMax / 50.0;
+    minStep = timeMax * 1e-9;
+    firstStep = min(T, maxStep);
+    T = firstStep;
+}
+
+//------------------------------------------------------------------------------
+// Backward Euler truncation error is about h^2/2 * x''. x'' comes from the
+// divided difference of the new point and the last two accepted ones.
+double AnalogCircuit::StepError(double vC, double iL) const {
+    if (historyCount < 2 || onBreakpoint) return 0.0; // Not enough smooth history
+    double x[2] = { vC, iL };
+    double err = 0.0;
+    for (int k = 0; k < 2; ++k) {
+        double d2 = 2.0 * ((x[k] - history[0][k]) / T - (history[0][k] - history[1][k]) / prevStep) / (T + prevStep);
+        double lte = 0.5 * T * T * fabs(d2);
+        err = max(err, lte / (absTol + relTol * max(fabs(x[k]), peak[k])));
+    }
+    return err;
+}
+
+//------------------------------------------------------------------------------
+// Accept the point just computed at currentTime and move to the next one
+void AnalogCircuit::NextStep(double err, double vC, double iL) {
+    bool crossed = onBreakpoint;
+    history[1][0] = history[0][0];
+    history[1][1] = history[0][1];
+    history[0][0] = vC;
+    history[0][1] = iL;
+    peak[0] = max(peak[0], fabs(vC));
+    peak[1] = max(peak[1], fabs(iL));
+    prevStep = T;
+    historyCount = crossed ? 1 : historyCount + 1;
+
+    // Grow at most 2x, shrink at most 5x, with a safety factor
+    double next = T;
+    if (crossed) next = firstStep; // Restart gently after the discontinuity
+    else if (historyCount > 2) next = T * (err > 0.0 ? min(2.0, max(0.2, 0.9 / sqrt(err))) : 2.0);
+    next = min(maxStep, max(minStep, next));
+
+    // Land exactly on the next source breakpoint, without leaving a sliver before it
+    onBreakpoint = false;
+    double breakpoint = NextBreakpoint();
+    if (breakpoint < HUGE_VAL) {
+        double remaining = breakpoint - currentTime;
+        if (next >= remaining * (1.0 - 1e-9)) onBreakpoint = true;
+        else if (next > 0.5 * remaining) next = 0.5 * remaining;
+    }
+    T = onBreakpoint ? breakpoint - currentTime : next;
+    currentTime = onBreakpoint ? breakpoint : currentTime + T;
+}
+
 //------------------------------------------------------------------------------
 bool AnalogCircuit::runStep() {
     if (currentTime >= timeMax) {
@@ -273,112 +351,358 @@ bool AnalogCircuit::runStep() {
         return false;
     }
 
-    PumpMessages();
-
-    // Apply sinusoidal voltage for first part, then 0V (as in sample) - this causes decay
-    double V_input = (currentTime < 0.6 * timeMax) ?
-        Vpeak * sin(2.0 * M_PI * freq * currentTime) : 0.0;
-
-    // Use heuristic cost function to find current
-    CostFunctionV(I, V_input, T);
-
-    // Get component pointers for updates
-    Capacitor* capacitor = nullptr;
-    Inductor* inductor = nullptr;
-    for (auto comp : components) {
-        if (dynamic_cast<Capacitor*>(comp)) capacitor = dynamic_cast<Capacitor*>(comp);
-        if (dynamic_cast<Inductor*>(comp)) inductor = dynamic_cast<Inductor*>(comp);
+    if (messagePump) messagePump();
+    uint64_t stepStartNs = Instrumentation::Now();
+
+    // Find current with the selected solver. In adaptive mode, retry with a
+    // shorter step (ending earlier) until the error test passes.
+    double V_input = 0.0, err = 0.0, vCNew = 0.0;
+    double stepStart = currentTime - T, startCurrent = I;
+    bool exact = solver == SOLVER_EXACT && extras.empty() && !stimulus;
+    for (;;) {
+        V_input = SourceVoltage(currentTime);
+        if (solver == SOLVER_HEURISTIC) CostFunctionV(I, V_input, T);
+        else if (solver == SOLVER_NEWTON) SolveNewton(I, V_input, T);
+        else if (exact) SolveExact(currentTime - T, currentTime, vCNew, I);
+        else SolveDirect(I, V_input, T);
+        if (!adaptive || exact) break; // The exact step has no truncation error
+
+        double Req, Veq;
+        rlc.Get<1>().GetCompanion(T, Req, Veq);
+        vCNew = Req * I + Veq; // Capacitor voltage at the end of the step
+        err = StepError(vCNew, I);
+        if (err <= 1.0 || T <= minStep) break;
+        rejectedSteps++;
+        stats.Count(STAT_REJECTED);
+        T = max(minStep, T * max(0.2, 0.9 / sqrt(err)));
+        currentTime = stepStart + T;
+        I = startCurrent;
     }
 
     // Compute voltages for output and history BEFORE state updates
-    double vR = components[0]->GetVoltage(I, T);
-    double vC = components[1]->GetVoltage(I, T);
-    double vL = components[2]->GetVoltage(I, T);
+    voltages.resize(components.size());
+    for (size_t k = 0; k < components.size() && !exact; ++k) {
+        if (solver == SOLVER_HEURISTIC) {
+            voltages[k] = components[k]->GetVoltage(I, T);
+        }
+        else if (solver == SOLVER_NEWTON) {
+            double dVdI;
+            components[k]->GetVoltageAndSlope(I, T, voltages[k], dVdI);
+        }
+        else {
+            // Companion voltages so that vR + vC + vL matches the source exactly
+            double Req, Veq;
+            components[k]->GetCompanion(T, Req, Veq);
+            voltages[k] = Req * I + Veq;
+        }
+    }
+    if (exact) {
+        voltages[0] = R_val * I;
+        voltages[1] = vCNew;
+        voltages[2] = V_input - voltages[0] - voltages[1]; // KVL at the end of the step
+    }
+    double vR = voltages[0], vC = voltages[1], vL = voltages[2];
+    uint64_t mark = stats.AddPhase(PHASE_SOLVE, stepStartNs);
 
     // Store for file output
-    fout << setw(12) << currentTime << setw(12) << I
-        << setw(12) << vR << setw(12) << vC << setw(12) << vL << endl;
+    if (recording && fout.IsOpen()) {
+        row.resize(components.size() + 2);
+        row[0] = currentTime;
+        row[1] = I;
+        for (size_t k = 0; k < components.size(); ++k) row[k + 2] = voltages[k];
+        fout.WriteRow(row.data(), static_cast<int>(row.size()));
+        stats.AddPhase(PHASE_OUTPUT, mark);
+    }
 
-    // Store for history
-    timeHistory.push_back(static_cast<float>(currentTime));
-    inputHistory.push_back(V_input);  
-    voltageHistory[0].push_back(vR);
-    voltageHistory[1].push_back(vC);
-    voltageHistory[2].push_back(vL);
+    // Publish for clients (viewer history, sweeps, ...)
+    lastSample = Sample{ currentTime, I, vR, vC, vL, V_input };
+    if (analytics) analytics->Add(lastSample);
 
     // ADDED: Debug print every 100 steps to confirm non-zero voltages (remove if not needed)
-    if (stepCount % 100 == 0) {
+    if (verbose && stepCount % 100 == 0) {
         cout << "Step " << stepCount << ": vR=" << vR << ", vC=" << vC << ", vL=" << vL << endl;
     }
 
-    // Update states
-    if (capacitor) {
-        capacitor->UpdateVoltage(I, T);
-    }
-    if (inductor) {
-        inductor->SetCurrent(I);
+    // Update states (the resistor has none)
+    if (exact) {
+        rlc.Get<1>().SetVoltage(vCNew);
+        rlc.Get<2>().SetCurrent(I);
     }
-	// Resistor has no state to update
-    currentTime += T;
+    else rlc.Commit(I, T);
+    for (auto& c : extras) c->Commit(I, T);
+    if (adaptive) NextStep(err, vCNew, I);
+    else currentTime += T;
     stepCount++;
 
+    if (checkpointEvery > 0 && stepCount % checkpointEvery == 0) SaveCheckpoint(checkpointFile);
+
+    stats.Count(STAT_STEPS);
+    stats.stepNanos.Add(Instrumentation::Now() - stepStartNs);
+
     return true;
 }
 
 //------------------------------------------------------------------------------
 void AnalogCircuit::run() {
-    // File header
-    fout << setw(12) << "Time" << setw(12) << "Current";
-    for (auto& c : components) fout << setw(12) << c->GetName();
-    fout << endl;
+    // File header, unless this continues a run restored from a checkpoint
+    if (fout.IsOpen() && stepCount == 0) {
+        vector<string> names{ "Time", "Current" };
+        for (auto& c : components) names.push_back(c->GetName());
+        fout.WriteHeader(names);
+    }
 
-    cout << "Running simulation..." << endl;
+    if (verbose) cout << "Running simulation..." << endl;
 
-    // Set up real-time simulation
+    // Set up simulation state, stepping is driven by the client
     simulationRunning = true;
     simulationComplete = false;
-    currentCircuit = this;
-    globalSimulationRunning = true;
-    globalSimulationComplete = false;
 }
 
 //------------------------------------------------------------------------------
-// Check if simulation is running
-bool isSimulationRunning() {
-    return globalSimulationRunning && currentCircuit && currentCircuit->simulationRunning;
+// Run every remaining step without any UI pacing
+int AnalogCircuit::runToCompletion() {
+    while (runStep()) {}
+    return stepCount;
 }
+
 //------------------------------------------------------------------------------
-// Check if simulation is complete
-bool isSimulationComplete() {
-    return globalSimulationComplete || (currentCircuit && currentCircuit->simulationComplete);
+// The writer latches a failed write, so one check at the end covers every row
+bool AnalogCircuit::CloseOutput() {
+    if (fout.Close()) return true;
+    cerr << "Error: Could not write data file " << dataFile << endl;
+    return false;
 }
 
 //------------------------------------------------------------------------------
-// Perform one simulation step
-void simulationStep() {
-    if (!currentCircuit) return;
+// Snapshot layout: magic and version, circuit parameters, data file name and
+// length, solver and step control state, then each element's name and state.
+// Values are written in the machine's native binary format.
+static const char checkpointMagic[8] = { 'A', 'N', 'A', 'S', 'I', 'M', 'C', 'K' };
+static const uint32_t checkpointVersion = 1;
+
+template <class Value>
+static void putValue(ostream& out, const Value& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+template <class Value>
+static bool getValue(istream& in, Value& v) { return bool(in.read(reinterpret_cast<char*>(&v), sizeof(v))); }
+
+static void putString(ostream& out, const string& s) {
+    putValue(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), s.size());
+}
+
+static bool getString(istream& in, string& s) {
+    uint32_t size;
+    if (!getValue(in, size) || size > (1u << 16)) return false;
+    s.resize(size);
+    return bool(in.read(&s[0], size));
+}
+
+// Header shared by the restart and fork paths
+static bool readCheckpointHeader(istream& in, double parameters[6], string& dataFilename, int64_t& dataLength) {
+    char magic[8];
+    uint32_t version;
+    if (!in.read(magic, sizeof(magic)) || !equal(magic, magic + 8, checkpointMagic)) return false;
+    if (!getValue(in, version) || version != checkpointVersion) return false;
+    for (int k = 0; k < 6; ++k)
+        if (!getValue(in, parameters[k])) return false;
+    return getString(in, dataFilename) && getValue(in, dataLength);
+}
 
-    if (currentCircuit->runStep()) {
-        // Simulation continues
-        glutPostRedisplay();
+//------------------------------------------------------------------------------
+// Written to a temporary file first, so a kill during the write leaves the
+// previous snapshot intact
+bool AnalogCircuit::SaveCheckpoint(const string& filename) {
+    int64_t dataLength = fout.IsOpen() ? fout.Position() : -1;
+    if (fout.IsOpen() && dataLength < 0) {
+        // A snapshot must not point past what actually reached the data file
+        cerr << "Error: Could not write data file " << dataFile << ", no checkpoint taken" << endl;
+        return false;
+    }
+    string temporary = filename + ".tmp";
+    ofstream out(temporary, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        cerr << "Error: Could not write checkpoint " << temporary << endl;
+        return false;
+    }
+
+    out.write(checkpointMagic, sizeof(checkpointMagic));
+    putValue(out, checkpointVersion);
+    for (double v : { R_val, L_val, C_val, freq, Vpeak, timeMax }) putValue(out, v);
+    putString(out, dataFile);
+    putValue(out, dataLength);
+
+    putValue(out, static_cast<int32_t>(solver));
+    putValue(out, static_cast<uint8_t>(adaptive));
+    for (double v : { T, relTol, absTol, minStep, maxStep, firstStep, prevStep,
+        history[0][0], history[0][1], history[1][0], history[1][1], peak[0], peak[1] }) putValue(out, v);
+    putValue(out, static_cast<int32_t>(historyCount));
+    putValue(out, static_cast<uint8_t>(onBreakpoint));
+    putValue(out, currentTime);
+    putValue(out, static_cast<int32_t>(stepCount));
+    putValue(out, I);
+    putValue(out, static_cast<int32_t>(rejectedSteps));
+    putValue(out, static_cast<int64_t>(solverIterations));
+    putValue(out, static_cast<int32_t>(maxStepIterations));
+    putValue(out, lastSample);
+
+    vector<double> state;
+    putValue(out, static_cast<uint32_t>(components.size()));
+    for (auto& c : components) {
+        state.clear();
+        c->SaveState(state);
+        putString(out, c->GetName());
+        putValue(out, static_cast<uint32_t>(state.size()));
+        for (double v : state) putValue(out, v);
+    }
+    out.close();
+    if (!out) {
+        cerr << "Error: Could not write checkpoint " << temporary << endl;
+        return false;
+    }
+
+    // Replaces the old snapshot in one step (std::rename may refuse an existing target on Windows)
+    error_code failed;
+    filesystem::rename(temporary, filename, failed);
+    if (failed) {
+        cerr << "Error: Could not replace checkpoint " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool AnalogCircuit::ReadCheckpointParameters(const string& filename, double& R, double& L, double& C,
+    double& frequency, double& peakVoltage, double& simTime, string& dataFilename) {
+    ifstream in(filename, ios::binary);
+    double parameters[6];
+    int64_t dataLength;
+    if (!in.is_open() || !readCheckpointHeader(in, parameters, dataFilename, dataLength)) {
+        cerr << "Error: " << filename << " is not a readable checkpoint" << endl;
+        return false;
+    }
+    R = parameters[0];
+    L = parameters[1];
+    C = parameters[2];
+    frequency = parameters[3];
+    peakVoltage = parameters[4];
+    simTime = parameters[5];
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Everything is read and checked before the circuit or any file is touched
+bool AnalogCircuit::LoadCheckpoint(const string& filename, const string& dataFilename) {
+    ifstream in(filename, ios::binary);
+    double parameters[6];
+    string savedData;
+    int64_t dataLength;
+    if (!in.is_open() || !readCheckpointHeader(in, parameters, savedData, dataLength)) {
+        cerr << "Error: " << filename << " is not a readable checkpoint" << endl;
+        return false;
+    }
+
+    int32_t savedSolver, savedHistoryCount, savedStepCount, savedRejected, savedMaxIterations;
+    uint8_t savedAdaptive, savedBreakpoint;
+    int64_t savedIterations;
+    double step[13], savedTime, savedCurrent;
+    Sample savedSample;
+    bool ok = getValue(in, savedSolver) && getValue(in, savedAdaptive);
+    for (int k = 0; k < 13 && ok; ++k) ok = getValue(in, step[k]);
+    ok = ok && getValue(in, savedHistoryCount) && getValue(in, savedBreakpoint) && getValue(in, savedTime)
+        && getValue(in, savedStepCount) && getValue(in, savedCurrent) && getValue(in, savedRejected)
+        && getValue(in, savedIterations) && getValue(in, savedMaxIterations) && getValue(in, savedSample);
+
+    uint32_t count = 0;
+    ok = ok && getValue(in, count);
+    if (ok && count != components.size()) {
+        cerr << "Error: checkpoint " << filename << " has " << count << " elements, this circuit has "
+            << components.size() << endl;
+        return false;
+    }
+    vector<vector<double>> states(components.size());
+    for (size_t k = 0; k < components.size() && ok; ++k) {
+        string name;
+        uint32_t size;
+        ok = getString(in, name) && getValue(in, size);
+        if (ok && (name != components[k]->GetName() || int(size) != components[k]->StateSize())) {
+            cerr << "Error: checkpoint element " << name << " does not match " << components[k]->GetName() << endl;
+            return false;
+        }
+        states[k].resize(size);
+        for (uint32_t j = 0; j < size && ok; ++j) ok = getValue(in, states[k][j]);
+    }
+    if (!ok) {
+        cerr << "Error: checkpoint " << filename << " is truncated" << endl;
+        return false;
     }
-    else {
-        // Simulation complete
-        globalSimulationRunning = false;
-        globalSimulationComplete = true;
-        cout << "Simulation completed. " << currentCircuit->stepCount << " time steps executed." << endl;
-        cout << "Data written to RLC.dat" << endl;
-        glutPostRedisplay(); // Final update
+
+    // Data file: cut the same file back to the snapshot, or start a fork with the shared prefix
+    fout.Close();
+    if (!dataFilename.empty()) {
+        error_code failed;
+        if (dataLength < 0) {
+            cerr << "Error: checkpoint " << filename << " was taken without a data file" << endl;
+            return false;
+        }
+        // Another spelling of the same file (./RLC.dat) must not count as a fork:
+        // truncating the target would destroy the source
+        bool same = dataFilename == savedData;
+        if (!same && filesystem::exists(dataFilename, failed) && filesystem::exists(savedData, failed))
+            same = filesystem::equivalent(savedData, dataFilename, failed);
+        failed.clear();
+        if (filesystem::file_size(savedData, failed) < uint64_t(dataLength) || failed) {
+            cerr << "Error: data file " << savedData << " is shorter than the checkpoint" << endl;
+            return false;
+        }
+        // A fork copies the whole file and cuts the copy back, never holding it in memory
+        if (!same) filesystem::copy_file(savedData, dataFilename, filesystem::copy_options::overwrite_existing, failed);
+        if (!failed) filesystem::resize_file(dataFilename, dataLength, failed);
+        if (failed || !fout.Open(dataFilename, true)) {
+            cerr << "Error: Could not continue data file " << dataFilename << endl;
+            return false;
+        }
     }
+    dataFile = dataFilename;
+
+    solver = static_cast<SolverMode>(savedSolver);
+    adaptive = savedAdaptive != 0;
+    T = step[0];
+    relTol = step[1];
+    absTol = step[2];
+    minStep = step[3];
+    maxStep = step[4];
+    firstStep = step[5];
+    prevStep = step[6];
+    history[0][0] = step[7];
+    history[0][1] = step[8];
+    history[1][0] = step[9];
+    history[1][1] = step[10];
+    peak[0] = step[11];
+    peak[1] = step[12];
+    historyCount = savedHistoryCount;
+    onBreakpoint = savedBreakpoint != 0;
+    currentTime = savedTime;
+    stepCount = savedStepCount;
+    I = savedCurrent;
+    rejectedSteps = savedRejected;
+    solverIterations = savedIterations;
+    maxStepIterations = savedMaxIterations;
+    lastSample = savedSample;
+    for (size_t k = 0; k < components.size(); ++k)
+        if (!states[k].empty()) components[k]->LoadState(states[k].data());
+    simulationComplete = false;
+    return true;
 }
 
 //------------------------------------------------------------------------------
 // Destructor to clean up components and close file
 AnalogCircuit::~AnalogCircuit() {
-    for (auto& c : components) delete c;
+    for (auto& c : extras) delete c;
+    extras.clear();
     components.clear();
-    if (fout.is_open()) fout.close();
-    currentCircuit = nullptr;
+    delete stimulus;
+    fout.Close();
 }
 
 //------------------------------------------------------------------------------
@@ -390,3 +714,9 @@ void Inductor::Display() {
 
 void Resistor::Display() {
 }
+
+void Diode::Display() {
+}
+
+void SaturableInductor::Display() {
+}
@@ -1,34 +1,44 @@
 #ifndef _ANALOGCIRCUITH
 #define _ANALOGCIRCUITH
 
+// Core simulation library: no OpenGL, GLUT or OS user-interface dependencies.
+// The GLUT viewer (AnalogCircuitViewer) and the batch driver (AnalogCircuitCLI)
+// are both clients of this class.
+
 #include <fstream>
 #include <vector>  // Using vector instead of list for components
 #include <string>
-#include <Windows.h> // Windows API for timing or console operations
-#include <gl/GL.h> //Open GL core functions
-#include <gl/GLU.h>   // Open GL utility library
-#include <gl/glut.h> // glut for windowing and input
-#include <gl/freeglut.h> // FreeGLUT extension for GLUT
-#include "Component.h" // User defined component class
-
-// Global variables for graphics
-extern int windowWidth; // Width of the OpenGL window
-extern int windowHeight; // Height of the OpenGL window
-extern double scalingFactor; //Scaling factor for drawing components
-
-// Global voltage history for drawing (now double for precision)
-extern std::vector<std::vector<double>> voltageHistory;
-extern std::vector<float> timeHistory;
-
-void start(); // Start the simulation
-void drawVoltageHistory(); // Draw voltage vs time plot
-void simulationStep(); // Perform one simulation step
-bool isSimulationRunning(); // Check if simulation is running
-bool isSimulationComplete(); // Check if simulation is complete
+#include "Capacitor.h" // Series RLC elements, stored by value
+#include "ComponentStore.h" // Devirtualised component containers
+#include "Inductor.h"
+#include "Instrumentation.h" // Run statistics
+#include "Resistor.h"
+#include "Stimulus.h" // Pluggable source waveforms
+#include "TraceWriter.h" // Buffered background file output
+
+class WaveformAnalytics; // Online metrics, see WaveformAnalytics.h
+
+// Method used to find the loop current at each time step
+enum SolverMode {
+    SOLVER_DIRECT,    // One closed-form solve of the component companion models
+    SOLVER_HEURISTIC, // Original trial-and-error search in CostFunctionV
+    SOLVER_NEWTON,    // Damped Newton-Raphson on the loop equation, for nonlinear parts
+    SOLVER_EXACT      // Exact discretisation of the linear R1/C1/L1 loop (matrix exponential)
+};
+
+// One simulated time point as seen by clients of the core
+struct Sample {
+    double time;    // Simulation time (s)
+    double current; // Loop current (A)
+    double vR;      // Resistor voltage (V)
+    double vC;      // Capacitor voltage (V)
+    double vL;      // Inductor voltage (V)
+    double vin;     // Source voltage (V)
+};
 
 class AnalogCircuit {
     // Simulation parameters - will be set by user input
-    double T; // Time step 
+    double T; // Time step
 	double tolerance; //Convergence tolerance for iterative methods
 	double freq; // Input signal frequency
 
@@ -36,8 +46,47 @@ class AnalogCircuit {
 	double R_val, L_val, C_val; // Resistance, Inductance, Capacitance
 
     double I;  // Circuit current
-    std::vector<Component*> components;  // FIXED: Changed from std::list for [] access
-	std::ofstream fout; //File output stream
+    SolverMode solver; // Current solver selection
+    bool verbose; // Print progress messages to cout
+    void (*messagePump)(); // Optional UI hook called while solving, may be null
+    double cutoffTime; // Source switches off here (0.6 * timeMax by default)
+    Stimulus* stimulus; // Source waveform replacing the switched sine, null = none, owned
+    bool recording; // runStep() writes rows to the data file
+    WaveformAnalytics* analytics; // Fed every accepted step, may be null, not owned
+    StaticCircuit<Resistor, Capacitor, Inductor> rlc; // R1, C1, L1 inline; the solver loops call them directly
+    std::vector<Component*> extras; // Elements added with AddComponent(), owned
+    std::vector<Component*> components; // Virtual view of every element: R1, C1, L1, then extras
+	TraceWriter fout; //Buffered output for the data file
+    std::string dataFile; // Name of the data file, empty = none
+    std::string checkpointFile; // Snapshot written every checkpointEvery steps
+    int checkpointEvery; // 0 = no periodic checkpoints
+    std::vector<double> voltages; // Voltage across each component this step
+    std::vector<double> row; // Output row: time, current, component voltages
+
+    // Adaptive time stepping (see SetAdaptive)
+    bool adaptive; // Choose T each step from the local truncation error
+    double relTol, absTol; // Error tolerances
+    double minStep, maxStep; // Step size limits
+    double firstStep; // Step used at the start and after a breakpoint
+    double prevStep; // Length of the previous accepted step
+    double history[2][2]; // vC and iL at the last two accepted points, newest first
+    double peak[2]; // Largest |vC| and |iL| so far
+    int historyCount; // Accepted points since the start or the last breakpoint
+    bool onBreakpoint; // The pending step ends exactly on a source discontinuity
+
+    // Exact discretisation: z = (vC, iL, s, c) with the sine source generated
+    // by the oscillator s' = w c, c' = -w s, so dz/dt = M z with constant M and
+    // one step is z <- exp(M h) z, exact for any h. Extra elements make the
+    // loop nonlinear and a stimulus has no closed form; SOLVER_EXACT then falls
+    // back to SOLVER_DIRECT.
+    double exactStep; // Step length exactPhi was built for, 0 = none yet
+    std::vector<double> exactPhi; // exp(M * exactStep), 4 x 4 row-major
+    void SolveExact(double from, double to, double& vC, double& iL); // State at 'to' from the committed state at 'from'
+
+    double SourceVoltage(double t) const; // Input waveform including the cutoff
+    double NextBreakpoint() const; // Next source discontinuity after currentTime, HUGE_VAL = none
+    double StepError(double vC, double iL) const; // Estimated error / tolerance, <= 1 passes
+    void NextStep(double err, double vC, double iL); // Record the accepted point and pick the next T
 
 public:
     // Simulation state - MADE PUBLIC
@@ -47,22 +96,70 @@ public:
 	int stepCount; //Number of simulation steps taken
     double timeMax;  // FIXED: Made public for access in display()
     double Vpeak;    // FIXED: Made public for access in display()
+    Sample lastSample; // Values produced by the most recent runStep()
+    int rejectedSteps; // Adaptive steps retried with a smaller T
+    long long solverIterations; // Iterations of the heuristic or Newton solver, all steps
+    int maxStepIterations; // Most iterations any single step needed
+    Instrumentation stats; // Step time, iteration and phase statistics, readable while running
 
 
-	//Constructor with user-defined parameters
+	//Constructor with user-defined parameters, empty filename disables file output
     AnalogCircuit(std::string filename, double R, double L, double C,
         double frequency, double peakVoltage, double simTime);
 
-    // Graphics methods
-    static void display(float R, float G, float B); //Draw circuit or voltage in color
-    static void drawGrid(); // Draw the background grid
-    static void drawAxes(); // Draw X and Y axes
-
     // Simulation methods
 	void run(); //run the simulation
     bool runStep(); //Run one time step
+    int runToCompletion(); //Run all remaining steps in a tight loop, returns step count
+    bool CloseOutput(); //Finish the data file, false (with a message) if any row could not be written
     void CostFunctionV(double& current, double voltage, double timestep); //Adjust current based on voltage
-    
+    void SolveDirect(double& current, double voltage, double timestep); //Solve current from companion models
+    void SolveNewton(double& current, double voltage, double timestep); //Newton-Raphson using component slopes
+    void AddComponent(Component* c); //Add another element in series (e.g. a Diode), takes ownership
+    void SetSolver(SolverMode mode) { solver = mode; } //Select direct or heuristic solver
+    void SetVerbose(bool on) { verbose = on; } //Enable or disable progress output
+    void SetMessagePump(void (*pump)()) { messagePump = pump; } //Install UI message hook
+    void SetFlushPolicy(FlushPolicy policy, int rows = 1) { fout.SetFlushPolicy(policy, rows); } //When data reaches the file
+    void SetArchiveBits(int bits) { fout.SetArchiveBits(bits); } //Value precision of a .rlcz data file
+    const std::vector<Component*>& Components() const { return components; } //Series elements in loop order
+    void SetTimeStep(double step) { T = step; } //Fixed step length, call before stepping
+    double GetTimeStep() const { return T; } //Fixed step length (initial step when adaptive)
+    double GetTolerance() const { return tolerance; } //Convergence tolerance of the iterative solvers
+    void SetSourceCutoff(double t) { cutoffTime = t; } //When the source switches off, HUGE_VAL = never
+    void SetStimulus(Stimulus* s); //Drive the loop with this waveform instead of the sine (cutoff unused, exact solver falls back to direct), takes ownership
+    void SetRecording(bool on) { recording = on; } //Pause or resume data file rows
+    void SetAnalytics(WaveformAnalytics* a) { analytics = a; } //Feed every step's sample to a, null = none, not owned
+    double GetFrequency() const { return freq; } //Source frequency (Hz)
+
+    // State carried between steps: capacitor voltage and loop (inductor) current.
+    // Reset() rewinds the clock to 0 and starts from the given state, so a
+    // client can integrate the same interval from different initial conditions.
+    void GetState(double& vC, double& iL) const;
+    void Reset(double vC, double iL);
+
+    // Adaptive stepping: each step's backward Euler truncation error on vC and
+    // iL must stay within absTol + relTol * (peak of that state so far). T
+    // grows or shrinks between minStep and maxStep (0 = timeMax / 50), and a
+    // step always ends exactly on a source breakpoint: the cutoff (0.6 *
+    // timeMax), or the stimulus corners. Call before run().
+    void SetAdaptive(bool on, double rel = 1e-3, double abs = 1e-6, double maxStepSize = 0.0);
+
+    // Checkpoint/restart. A snapshot holds everything runStep() carries
+    // between steps (time, step count, current, solver and step control
+    // state, every element's state) plus the data file name and its length,
+    // in a small binary file. Loading it into a circuit with the same
+    // elements resumes bit-exactly: the data file is cut back to that length
+    // and appended to. Loading it with a different data file forks a
+    // continuation: the shared prefix is copied there instead. Element values,
+    // the source and timeMax are the loading circuit's own, so a fork may
+    // change them (what-if runs).
+    void SetCheckpoint(const std::string& filename, int everySteps) { checkpointFile = filename; checkpointEvery = everySteps; }
+    bool SaveCheckpoint(const std::string& filename); // Write a snapshot now
+    bool LoadCheckpoint(const std::string& filename, const std::string& dataFilename); // Empty data name = no file
+    // Circuit parameters recorded in a snapshot, to rebuild the same circuit for a restart
+    static bool ReadCheckpointParameters(const std::string& filename, double& R, double& L, double& C,
+        double& frequency, double& peakVoltage, double& simTime, std::string& dataFilename);
+
 
 	// Destructor to clean up components and close file
     ~AnalogCircuit();
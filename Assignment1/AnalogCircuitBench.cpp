@@ -0,0 +1,283 @@
+// AnalogCircuitBench.cpp - Microbenchmarks for the ANASIM hot paths
+//
+// Usage: AnalogCircuitBench [-r repeats] [--filter text] [--samples n] [-o file]
+//
+// Every benchmark does a fixed amount of work on a fixed parameter set and is
+// repeated; the JSON report gives the median, minimum and maximum time per
+// operation and a checksum of the computed values, so two builds can be
+// compared and shown to have done the same work. Progress goes to stderr,
+// the report to stdout unless -o names a file.
+//
+// Benchmarks (each for the "default" and the "stiff" circuit where it applies):
+//   cost_function/<case>         one CostFunctionV solve from a mid-run state
+//   run_step/<solver>/<case>     runStep end to end, no data file
+//   run_step_file/<solver>/<case> the same, writing the data file
+//   get_voltage/<element>        one GetVoltage call through Component*
+//   history_append/<layout>      one WaveformHistory sample
+//   display_frame/<layout>/<range> the scale scan and vertex generation of
+//                                one display() frame over a synthetic history
+
+#include "AnalogCircuit.h" // Simulation core
+#include "Diode.h" // Nonlinear series elements
+#include "SaturableInductor.h"
+#include "WaveformHistory.h" // Drawing history
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Fixed parameter sets
+struct BenchCase {
+    const char* name;
+    double R, L, C, freq, Vpeak;
+};
+
+static const BenchCase benchCases[] = {
+    { "default", 20.0, 0.05, 0.00007, 50.0, 10.0 }, // Viewer defaults
+    { "stiff", 2000.0, 0.05, 0.00007, 50.0, 10.0 }, // L/R = 25 us against T = 100 us and RC = 0.14 s
+};
+
+// One reported measurement
+struct BenchResult {
+    string name;
+    double operations; // Operations per repeat
+    vector<double> seconds; // Wall time of each repeat
+    double checksum; // Sum of computed values, identical between builds doing the same work
+    double perOperation; // Extra figure: solver iterations per call, bytes per sample, ...
+    const char* perOperationName; // Its JSON key, null = none
+};
+
+static vector<BenchResult> results;
+static int repeats = 5;
+static string filter;
+
+//------------------------------------------------------------------------------
+// Time 'body' (which returns its checksum) 'repeats' times
+static void measure(const string& name, double operations, const function<double()>& body,
+    double perOperation = 0.0, const char* perOperationName = nullptr) {
+    if (!filter.empty() && name.find(filter) == string::npos) return;
+    cerr << name << "..." << endl;
+    BenchResult r{ name, operations, {}, 0.0, perOperation, perOperationName };
+    for (int k = 0; k < repeats; ++k) {
+        auto begin = chrono::steady_clock::now();
+        double checksum = body();
+        r.seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - begin).count());
+        if (k == 0) r.checksum = checksum;
+    }
+    results.push_back(r);
+}
+
+//------------------------------------------------------------------------------
+static const char* solverName(SolverMode solver) {
+    switch (solver) {
+    case SOLVER_HEURISTIC: return "heuristic";
+    case SOLVER_NEWTON: return "newton";
+    case SOLVER_EXACT: return "exact";
+    default: return "direct";
+    }
+}
+
+//------------------------------------------------------------------------------
+// CostFunctionV alone: the circuit is stepped 200 times with the direct
+// solver, then the heuristic solve for the next step is repeated against a
+// fixed set of source voltages without committing, so every repeat does the
+// same iterations
+static void benchCostFunction(const BenchCase& c) {
+    const int calls = 20000;
+    AnalogCircuit circuit("", c.R, c.L, c.C, c.freq, c.Vpeak, 1.0);
+    circuit.SetVerbose(false);
+    circuit.run();
+    for (int k = 0; k < 200; ++k) circuit.runStep();
+    double start = circuit.lastSample.current;
+    long long before = circuit.solverIterations;
+
+    auto body = [&]() {
+        double sum = 0.0;
+        for (int k = 0; k < calls; ++k) {
+            double I = start;
+            double V = c.Vpeak * sin(2.0 * M_PI * (k % 64) / 64.0);
+            circuit.CostFunctionV(I, V, 0.0001);
+            sum += I;
+        }
+        return sum;
+    };
+    body(); // Iteration count for the report
+    double iterations = double(circuit.solverIterations - before) / calls;
+    measure(string("cost_function/") + c.name, calls, body, iterations, "iterations_per_call");
+}
+
+//------------------------------------------------------------------------------
+// runStep over a fixed 1 s transient (10000 steps at the default T)
+static void benchRunStep(const BenchCase& c, SolverMode solver, bool file) {
+    const char* dataFile = "AnalogCircuitBench.dat";
+    string name = string(file ? "run_step_file/" : "run_step/") + solverName(solver) + "/" + c.name;
+    int steps = 0;
+    auto body = [&]() {
+        AnalogCircuit circuit(file ? dataFile : "", c.R, c.L, c.C, c.freq, c.Vpeak, 1.0);
+        circuit.SetSolver(solver);
+        circuit.SetVerbose(false);
+        circuit.run();
+        double sum = 0.0;
+        while (circuit.runStep()) sum += circuit.lastSample.current;
+        steps = circuit.stepCount;
+        return sum;
+    };
+    body(); // Step count, and warms the file system cache
+    measure(name, steps, body);
+    if (file) remove(dataFile);
+}
+
+//------------------------------------------------------------------------------
+// One GetVoltage per call through the virtual interface, as the heuristic
+// solver and the output loop call it
+static void benchGetVoltage() {
+    const int calls = 10000000;
+    vector<Component*> parts{ new Resistor(20.0, 1.0f, 0.0f, 0.0f, "R1"),
+        new Capacitor(0.00007, 0.0f, 1.0f, 0.0f, "C1"), new Inductor(0.05, 0.0f, 0.0f, 1.0f, "L1"),
+        new Diode(1e-14, 1.0, 1.0f, 1.0f, 0.0f, "D1"), new SaturableInductor(0.05, 0.3, 0.0f, 1.0f, 1.0f, "LS1") };
+    const char* names[] = { "resistor", "capacitor", "inductor", "diode", "saturable_inductor" };
+    for (size_t p = 0; p < parts.size(); ++p) {
+        Component* part = parts[p];
+        measure(string("get_voltage/") + names[p], calls, [&]() {
+            double sum = 0.0;
+            for (int k = 0; k < calls; ++k) sum += part->GetVoltage(1e-3 * (k & 1023) / 1024.0, 0.0001);
+            return sum;
+        });
+    }
+    for (auto& c : parts) delete c;
+}
+
+//------------------------------------------------------------------------------
+// Synthetic history: four traces like the viewer's, one sample per 1e-4 s
+static void fillHistory(WaveformHistory& history, size_t samples) {
+    for (size_t k = 0; k < samples; ++k) {
+        double t = k * 0.0001;
+        double row[4] = { 4.0 * sin(314.0 * t), 9.0 * sin(314.0 * t - 1.2), 3.0 * sin(314.0 * t + 1.9) * exp(-t),
+            10.0 * sin(314.0 * t) };
+        history.Append(t, row);
+    }
+}
+
+//------------------------------------------------------------------------------
+// What display() does per frame once samples are in the history: the
+// max-abs scan for the scale, then per trace the column reduction and the
+// transform to window coordinates (here into a vertex array instead of GL)
+static void benchDisplay(size_t samples) {
+    const int width = 1000, height = 600;
+    const int columns = width - 100;
+    for (int compact = 1; compact >= 0; --compact) {
+        const char* layout = compact ? "float32" : "double";
+        WaveformHistory history(4, RETAIN_ALL, 0, compact != 0);
+        fillHistory(history, samples);
+        measure(string("history_append/") + layout, double(samples), [&]() {
+            history.Clear();
+            fillHistory(history, samples);
+            return history.MaxAbs(1);
+        }, double(history.MemoryBytes()) / samples, "bytes_per_sample");
+
+        double tEnd = history.Time(history.Size() - 1);
+        struct Range { const char* name; double from; } ranges[] = {
+            { "full", history.Time(0) }, { "zoom1pct", tEnd * 0.99 } };
+        for (auto& range : ranges) {
+            vector<float> xs, vertices;
+            vector<double> vs;
+            const int frames = 200;
+            measure(string("display_frame/") + layout + "/" + range.name, frames, [&]() {
+                double sum = 0.0;
+                for (int f = 0; f < frames; ++f) {
+                    float actualMax = 10.0f;
+                    for (int i = 0; i < 4; ++i) actualMax = max(actualMax, static_cast<float>(history.MaxAbs(i)));
+                    float scale = (height / 2.0f - 50.0f) / (actualMax * 1.1f);
+                    for (int trace = 0; trace < 4; ++trace) {
+                        xs.clear();
+                        vs.clear();
+                        vertices.clear();
+                        history.Columns(trace, range.from, tEnd, columns, xs, vs);
+                        for (size_t j = 0; j < xs.size(); ++j) {
+                            float y = height / 2.0f + static_cast<float>(vs[j]) * scale;
+                            vertices.push_back(50.0f + xs[j]);
+                            vertices.push_back(min(max(y, 50.0f), height - 50.0f));
+                        }
+                        sum += vertices.size() + vertices.back();
+                    }
+                }
+                return sum;
+            });
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+//------------------------------------------------------------------------------
+// Same keys in the same order on every run; times in nanoseconds per operation
+static void writeJson(ostream& out, size_t samples) {
+    out << "{\n  \"suite\": \"anasim-bench\",\n  \"version\": 1,\n  \"instrumented\": "
+        << (ANASIM_INSTRUMENTED ? "true" : "false") << ",\n  \"repeats\": " << repeats
+        << ",\n  \"history_samples\": " << samples << ",\n  \"results\": [";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const BenchResult& r = results[k];
+        double scale = 1e9 / r.operations;
+        out << (k ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"operations\": " << setprecision(10)
+            << r.operations << setprecision(6) << ", \"median_ns\": " << median(r.seconds) * scale
+            << ", \"min_ns\": " << *min_element(r.seconds.begin(), r.seconds.end()) * scale
+            << ", \"max_ns\": " << *max_element(r.seconds.begin(), r.seconds.end()) * scale;
+        if (r.perOperationName) out << ", \"" << r.perOperationName << "\": " << r.perOperation;
+        out << ", \"checksum\": " << setprecision(17) << r.checksum << setprecision(6) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    string outFile = "-";
+    size_t samples = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) {
+            cout << "Usage: " << argv[0] << " [-r repeats] [--filter text] [--samples n] [-o file]" << endl;
+            return 0;
+        }
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; return 1; }
+        else if (!strcmp(opt, "-r")) repeats = max(1, atoi(argv[++i]));
+        else if (!strcmp(opt, "--filter")) filter = argv[++i];
+        else if (!strcmp(opt, "--samples")) samples = max<size_t>(2, strtoul(argv[++i], nullptr, 10));
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else { cerr << "Error: unknown option " << opt << endl; return 1; }
+    }
+
+    for (auto& c : benchCases) benchCostFunction(c);
+    for (int file = 0; file < 2; ++file)
+        for (SolverMode solver : { SOLVER_DIRECT, SOLVER_HEURISTIC, SOLVER_NEWTON, SOLVER_EXACT })
+            for (auto& c : benchCases) benchRunStep(c, solver, file != 0);
+    benchGetVoltage();
+    benchDisplay(samples);
+
+    if (outFile == "-") writeJson(cout, samples);
+    else {
+        ofstream out(outFile);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open " << outFile << " for writing" << endl;
+            return 1;
+        }
+        writeJson(out, samples);
+        cerr << "Results written to " << outFile << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,1042 @@
+// AnalogCircuitCLI.cpp - Headless batch driver for the ANASIM simulation core
+//
+// Usage: AnalogCircuitCLI [options]          single transient run
+//        AnalogCircuitCLI sweep [options]    parameter sweep (see sweepUsage)
+//        AnalogCircuitCLI ensemble [options] SIMD ensemble throughput (see ensembleUsage)
+//        AnalogCircuitCLI netlist <file> [-o out] transient run of a netlist (see MnaCircuit.h)
+//        AnalogCircuitCLI dispatch [-n evals] [-N sections]  virtual vs stored component loops
+//        AnalogCircuitCLI ac [options]       frequency response (see acUsage)
+//        AnalogCircuitCLI pss [options]      periodic steady state (see pssUsage)
+//        AnalogCircuitCLI history [options]  drawing history memory (see historyUsage)
+//        AnalogCircuitCLI montecarlo [options] tolerance analysis (see monteCarloUsage)
+//        AnalogCircuitCLI batch <jobs> [options] cached batch of jobs (see batchUsage)
+//        AnalogCircuitCLI ladder [options]   partitioned multi-threaded RLC ladder (see ladderUsage)
+//
+// Transient options:
+//   -R <ohms>      resistor value            (default 20)
+//   -L <henries>   inductor value            (default 0.05)
+//   -C <farads>    capacitor value           (default 7e-5)
+//   -f <hz>        source frequency          (default 50)
+//   -V <volts>     source peak voltage       (default 10)
+//   -t <seconds>   simulation time           (default 0.1)
+//   -o <file>      output data file          (default RLC.dat)
+//   --solver <direct|heuristic|newton|exact> (default direct)
+//   --step <s>     fixed time step           (default 1e-4)
+//   --diode        add a diode (Is 1e-14 A, n 1) in series
+//   --lsat <henries> --isat <amps>
+//                  add a saturable inductor in series
+//   --flush-rows <n>  flush the data file every n rows (default 0 = only
+//                     when a buffer fills and at the end)
+//   --archive-bits <n>  mantissa bits kept per value when -o ends in .rlcz
+//                     (compressed columnar file, see TraceArchive.h;
+//                     default 24, 52 = exact)
+//   --adaptive     choose the time step from the local truncation error
+//   --reltol <x>   adaptive relative tolerance (default 1e-3)
+//   --abstol <x>   adaptive absolute tolerance (default 1e-6)
+//   --max-step <s> adaptive step limit       (default t/50)
+//   --checkpoint <file>        save a restart snapshot periodically
+//   --checkpoint-every <steps> snapshot interval     (default 1000)
+//   --resume <file>  continue from a snapshot: circuit values and the data file
+//                    come from it unless given; -o with another name forks the
+//                    run, copying the shared prefix of the data file
+//   --stop-after <steps> stop early, as if the run had been killed
+//   --pwl <file>     drive the loop with a piecewise linear source ("time
+//                    value" per line) instead of the switched sine
+//   --pulse <v1,v2,delay,rise,fall,width,period>  SPICE-style pulse source
+//   --tones <a:f[:deg],...>  sum of sines (amplitude, frequency, phase)
+//   --wave <file> --wave-rate <hz>  raw float32 sample file, memory-mapped
+//   --wave-f64       the sample file holds float64
+//   --wave-gain <x>  scale the samples                  (default 1)
+//   --stats <file>   write step time, solver iteration and phase statistics
+//                    as JSON at the end ("-" = stdout)
+//   --stats-every <s> print the live counters to stderr every s seconds
+//   --analytics <file>  write RMS, peak, phase, harmonic amplitudes and THD of
+//                    every waveform as JSON at the end ("-" = stdout), computed
+//                    while the run goes on (see WaveformAnalytics.h)
+//   --analytics-window <from:to>  analysis window (default the last 10 whole
+//                    source periods before the source switches off, or before
+//                    the end of the run with a stimulus)
+//   --harmonics <n>  harmonics analysed, fundamental included (default 10)
+//   --no-trace       write no data file (-o is ignored)
+//   -v             print progress every 100 steps
+
+#include "AnalogCircuit.h" // Simulation core
+#include "ComponentStore.h" // By-value component containers
+#include "Diode.h" // Nonlinear series elements
+#include "SaturableInductor.h"
+#include "ParameterSweep.h" // Multi-core sweeps
+#include "EnsembleStepper.h" // SIMD lockstep circuits
+#include "MnaCircuit.h" // General netlist circuits
+#include "AcAnalysis.h" // Phasor frequency response
+#include "PeriodicSteadyState.h" // Shooting method
+#include "WaveformHistory.h" // Bounded sample history
+#include "MonteCarlo.h" // Tolerance analysis
+#include "BatchRunner.h" // Cached job batches
+#include "PartitionedTransient.h" // Multi-threaded ladder transient
+#include "WaveformAnalytics.h" // Online waveform metrics
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// Print command line help
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " [-R ohms] [-L henries] [-C farads] [-f hz] [-V volts]"
+        << " [-t seconds] [-o file] [--solver direct|heuristic|newton|exact] [--step s] [--flush-rows n] [--archive-bits n]"
+        << " [--diode] [--lsat henries --isat amps]"
+        << " [--adaptive] [--reltol x] [--abstol x] [--max-step s]"
+        << " [--checkpoint file] [--checkpoint-every steps] [--resume file] [--stop-after steps]"
+        << " [--stats file] [--stats-every seconds] [--analytics file] [--analytics-window from:to] [--harmonics n] [--no-trace]"
+        << " [--pwl file | --pulse v1,v2,td,tr,tf,pw,per | --tones a:f[:deg],... | --wave file --wave-rate hz"
+        << " [--wave-f64] [--wave-gain x]] [-v]" << endl;
+}
+
+//------------------------------------------------------------------------------
+// Parse a numeric option value, exits with a message on bad input
+static double parseValue(const char* opt, const char* text) {
+    double value;
+    if (!(istringstream(text) >> value)) {
+        cerr << "Error: invalid value '" << text << "' for " << opt << endl;
+        exit(1);
+    }
+    return value;
+}
+
+//------------------------------------------------------------------------------
+// Split "v1<sep>v2<sep>..." into numbers, exits with a message on bad input
+static vector<double> parseNumbers(const char* opt, const string& text, char separator) {
+    vector<double> values;
+    istringstream fields(text);
+    string field;
+    while (getline(fields, field, separator)) values.push_back(parseValue(opt, field.c_str()));
+    return values;
+}
+
+//------------------------------------------------------------------------------
+// Print sweep help
+static void sweepUsage(const char* prog) {
+    cout << "Usage: " << prog << " sweep [-R list] [-L list] [-C list] [-f list] [-V list]"
+        << " [-t seconds] [-j threads] [-o summary] [--traces prefix]" << endl;
+    cout << "  list is a value, v1,v2,... or start:stop:step" << endl;
+}
+
+//------------------------------------------------------------------------------
+// Parse a list or range option value, exits with a message on bad input
+static vector<double> parseList(const char* opt, const char* text) {
+    vector<double> values;
+    if (!ParameterSweep::ParseRange(text, values)) {
+        cerr << "Error: invalid list or range '" << text << "' for " << opt << endl;
+        exit(1);
+    }
+    return values;
+}
+
+//------------------------------------------------------------------------------
+// sweep command: run every R/L/C/freq/Vpeak combination across all cores
+static int runSweep(int argc, char** argv, const char* prog) {
+    vector<double> R{ 20.0 }, L{ 0.05 }, C{ 0.00007 }, freq{ 50.0 }, Vpeak{ 10.0 };
+    double simTime = 0.1;
+    unsigned threads = 0; // All cores
+    string summaryFile = "Sweep.dat";
+    string tracePrefix; // Empty = no per-configuration traces
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { sweepUsage(prog); return 0; }
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; sweepUsage(prog); return 1; }
+        else if (!strcmp(opt, "-R")) R = parseList(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseList(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseList(opt, argv[++i]);
+        else if (!strcmp(opt, "-f")) freq = parseList(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseList(opt, argv[++i]);
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-j")) threads = static_cast<unsigned>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-o")) summaryFile = argv[++i];
+        else if (!strcmp(opt, "--traces")) tracePrefix = argv[++i];
+        else { cerr << "Error: unknown option " << opt << endl; sweepUsage(prog); return 1; }
+    }
+
+    ParameterSweep sweep(R, L, C, freq, Vpeak, simTime);
+    auto begin = chrono::steady_clock::now();
+    sweep.Run(threads, tracePrefix);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    sweep.WriteSummary(summaryFile);
+
+    cout << "Sweep completed. " << sweep.Count() << " configurations in "
+        << elapsed * 1000.0 << " ms." << endl;
+    cout << "Summary written to " << summaryFile << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print ensemble help
+static void ensembleUsage(const char* prog) {
+    cout << "Usage: " << prog << " ensemble [-n circuits] [-R ohms] [-L henries] [-C farads]"
+        << " [-s spread] [-f hz] [-V volts] [-t seconds] [--isa scalar|avx2|avx512]" << endl;
+    cout << "  circuits get R/L/C spread linearly over +/- spread (fraction) around the given values" << endl;
+}
+
+//------------------------------------------------------------------------------
+// ensemble command: step many circuits in lockstep, report throughput and
+// agreement with AnalogCircuit::runStep on a few of them
+static int runEnsemble(int argc, char** argv, const char* prog) {
+    size_t n = 100000;
+    double R = 20.0, L = 0.05, C = 0.00007, spread = 0.1;
+    double freq = 50.0, Vpeak = 10.0, simTime = 0.1;
+    EnsembleIsa isa = EnsembleStepper::DetectIsa();
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { ensembleUsage(prog); return 0; }
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; ensembleUsage(prog); return 1; }
+        else if (!strcmp(opt, "-n")) n = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-s")) spread = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-f")) freq = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--isa")) {
+            string name = argv[++i];
+            if (name == "scalar") isa = ENSEMBLE_SCALAR;
+            else if (name == "avx2") isa = ENSEMBLE_AVX2;
+            else if (name == "avx512") isa = ENSEMBLE_AVX512;
+            else { cerr << "Error: unknown isa " << name << endl; return 1; }
+        }
+        else { cerr << "Error: unknown option " << opt << endl; ensembleUsage(prog); return 1; }
+    }
+    if (n == 0) { cerr << "Error: need at least one circuit" << endl; return 1; }
+
+    // Deterministic spread so runs are repeatable
+    EnsembleStepper ensemble(n, 0.0001); // Same fixed T as AnalogCircuit
+    auto scale = [&](size_t i, size_t k) {
+        double u = n > 1 ? double((i * (k + 1) * 7919) % n) / (n - 1) : 0.5;
+        return 1.0 + spread * (2.0 * u - 1.0);
+    };
+    for (size_t i = 0; i < n; ++i) ensemble.SetCircuit(i, R * scale(i, 0), L * scale(i, 1), C * scale(i, 2));
+    ensemble.SetIsa(isa);
+
+    auto begin = chrono::steady_clock::now();
+    int steps = ensemble.Run(freq, Vpeak, simTime);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    // Cross-check a handful of circuits against the reference solver
+    double maxError = 0.0;
+    for (size_t k = 0; k < min<size_t>(n, 8); ++k) {
+        size_t i = k * (n / min<size_t>(n, 8));
+        AnalogCircuit reference("", R * scale(i, 0), L * scale(i, 1), C * scale(i, 2), freq, Vpeak, simTime);
+        reference.SetVerbose(false);
+        reference.run();
+        double peakVC = 0.0;
+        while (reference.runStep()) peakVC = max(peakVC, fabs(reference.lastSample.vC));
+        maxError = max(maxError, fabs(peakVC - ensemble.PeakCapacitorVoltage()[i]) / max(peakVC, 1e-12));
+    }
+
+    cout << "Ensemble (" << EnsembleStepper::IsaName(ensemble.GetIsa()) << "): " << n << " circuits x "
+        << steps << " steps in " << elapsed * 1000.0 << " ms = "
+        << double(n) * steps / elapsed << " circuit-steps/s" << endl;
+    cout << "Max relative peak vC error vs AnalogCircuit: " << maxError << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// netlist command: load a netlist and run its .tran analysis
+static int runNetlist(int argc, char** argv, const char* prog) {
+    string netlistFile, outFile = "Netlist.dat";
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) {
+            cout << "Usage: " << prog << " netlist <file> [-o out.dat]" << endl;
+            return 0;
+        }
+        else if (!strcmp(opt, "-o") && i + 1 < argc) outFile = argv[++i];
+        else if (opt[0] != '-' && netlistFile.empty()) netlistFile = opt;
+        else { cerr << "Error: unknown option " << opt << endl; return 1; }
+    }
+    if (netlistFile.empty()) { cerr << "Error: no netlist file given" << endl; return 1; }
+
+    MnaCircuit circuit;
+    if (!circuit.LoadNetlist(netlistFile)) return 1;
+
+    auto begin = chrono::steady_clock::now();
+    if (!circuit.run(outFile)) return 1;
+    circuit.runToCompletion();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    const MnaSystem& mna = circuit.System();
+    double stepTime = (elapsed - circuit.factorTime) / max(circuit.stepCount, 1);
+    cout << circuit.title << ": " << circuit.NodeCount() - 1 << " nodes, " << circuit.ComponentCount()
+        << " elements, " << circuit.stepCount << " steps in " << elapsed * 1000.0 << " ms" << endl;
+    cout << "Matrix " << mna.Size() << " x " << mna.Size() << ", " << mna.MatrixNonZeros() << " nonzeros, "
+        << mna.FactorNonZeros() << " in LU" << (mna.IsDense() ? " (dense fallback)" : "") << ", "
+        << mna.FactorFlops() << " flops per factorization" << endl;
+    cout << "Factor " << circuit.factorTime * 1000.0 << " ms (" << mna.FactorCount() << " numeric, "
+        << mna.AnalyzeCount() << " symbolic), " << stepTime * 1e6 << " us per step" << endl;
+    if (circuit.newtonIterations > 0) {
+        cout << "Newton: " << double(circuit.newtonIterations) / max(circuit.stepCount, 1) << " iterations per step, "
+            << circuit.maxStepIterations << " at most, " << circuit.nonConverged << " steps did not converge" << endl;
+    }
+    if (!circuit.CloseOutput()) return 1;
+    cout << "Results written to " << outFile << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print AC analysis help
+static void acUsage(const char* prog) {
+    cout << "Usage: " << prog << " ac [-R ohms] [-L henries] [-C farads] [-V volts]"
+        << " [--fstart hz] [--fstop hz] [-n points] [-j threads] [-o file]"
+        << " [--diode] [--lsat henries --isat amps]" << endl;
+    cout << "  points are log-spaced from fstart to fstop (default 1 Hz to 100 kHz, 1000 points)" << endl;
+}
+
+//------------------------------------------------------------------------------
+// ac command: phasor solve of the series circuit over a log-spaced frequency
+// list, written as Bode plot data
+static int runAc(int argc, char** argv, const char* prog) {
+    double R = 20.0, L = 0.05, C = 0.00007, Vpeak = 10.0;
+    double fStart = 1.0, fStop = 100000.0;
+    size_t points = 1000;
+    unsigned threads = 0; // All cores
+    string outFile = "Bode.dat";
+    bool diode = false;
+    double lsat = 0.0, isat = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { acUsage(prog); return 0; }
+        else if (!strcmp(opt, "--diode")) diode = true;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; acUsage(prog); return 1; }
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--fstart")) fStart = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--fstop")) fStop = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-n")) points = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-j")) threads = static_cast<unsigned>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else if (!strcmp(opt, "--lsat")) lsat = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--isat")) isat = parseValue(opt, argv[++i]);
+        else { cerr << "Error: unknown option " << opt << endl; acUsage(prog); return 1; }
+    }
+    if (fStart <= 0.0 || fStop < fStart || points == 0) {
+        cerr << "Error: need 0 < fstart <= fstop and at least one point" << endl;
+        return 1;
+    }
+
+    // The same series circuit a transient run would build, at its initial operating point
+    AnalogCircuit circuit("", R, L, C, 0.0, Vpeak, 0.0);
+    if (diode) circuit.AddComponent(new Diode(1e-14, 1.0, 1.0f, 1.0f, 0.0f, "D1"));
+    if (lsat > 0.0) circuit.AddComponent(new SaturableInductor(lsat, isat, 0.0f, 1.0f, 1.0f, "LS1"));
+
+    AcAnalysis ac(circuit.Components(), Vpeak);
+    vector<double> freqs = AcAnalysis::LogSpace(fStart, fStop, points);
+    auto begin = chrono::steady_clock::now();
+    ac.Run(freqs, threads);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    ac.WriteBode(outFile);
+
+    size_t peak = 0;
+    for (size_t i = 1; i < ac.Count(); ++i)
+        if (abs(ac.Current(i)) > abs(ac.Current(peak))) peak = i;
+    cout << "AC analysis: " << ac.Count() << " frequencies in " << elapsed * 1000.0 << " ms" << endl;
+    cout << "Peak current " << abs(ac.Current(peak)) << " A at " << ac.Frequency(peak) << " Hz (series resonance "
+        << 1.0 / (2.0 * 3.14159265358979323846 * sqrt(L * C)) << " Hz)" << endl;
+    cout << "Bode data written to " << outFile << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print periodic steady state help
+static void pssUsage(const char* prog) {
+    cout << "Usage: " << prog << " pss [-R ohms] [-L henries] [-C farads] [-f hz] [-V volts]"
+        << " [-o file] [--solver direct|newton|exact] [--tol x] [--diode] [--lsat henries --isat amps]" << endl;
+    cout << "  writes one steady-state period and compares with running the start-up transient out" << endl;
+}
+
+//------------------------------------------------------------------------------
+// pss command: shoot for the periodic steady state, write one period, and
+// count how many periods plain integration from rest needs to get as close
+static int runPss(int argc, char** argv, const char* prog) {
+    double R = 20.0, L = 0.05, C = 0.00007, freq = 50.0, Vpeak = 10.0, tol = 1e-9;
+    string outFile = "PSS.dat";
+    SolverMode solver = SOLVER_DIRECT;
+    bool diode = false;
+    double lsat = 0.0, isat = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { pssUsage(prog); return 0; }
+        else if (!strcmp(opt, "--diode")) diode = true;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; pssUsage(prog); return 1; }
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-f")) freq = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else if (!strcmp(opt, "--tol")) tol = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--lsat")) lsat = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--isat")) isat = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--solver")) {
+            string name = argv[++i];
+            if (name == "direct") solver = SOLVER_DIRECT;
+            else if (name == "newton") solver = SOLVER_NEWTON;
+            else if (name == "exact") solver = SOLVER_EXACT;
+            else { cerr << "Error: pss needs the direct, newton or exact solver" << endl; return 1; }
+        }
+        else { cerr << "Error: unknown option " << opt << endl; pssUsage(prog); return 1; }
+    }
+    if (freq <= 0.0) { cerr << "Error: pss needs a positive source frequency" << endl; return 1; }
+
+    auto build = [&](AnalogCircuit& circuit) {
+        circuit.SetVerbose(false);
+        circuit.SetSolver(solver);
+        if (diode) circuit.AddComponent(new Diode(1e-14, 1.0, 1.0f, 1.0f, 0.0f, "D1"));
+        if (lsat > 0.0) circuit.AddComponent(new SaturableInductor(lsat, isat, 0.0f, 1.0f, 1.0f, "LS1"));
+    };
+
+    AnalogCircuit circuit(outFile, R, L, C, freq, Vpeak, 1.0 / freq);
+    build(circuit);
+    circuit.run();
+    PeriodicSteadyState pss(circuit, 0.0001); // Same nominal T as a transient run
+    auto begin = chrono::steady_clock::now();
+    bool converged = pss.Solve(tol);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    pss.EmitPeriod();
+
+    // Reference: the start-up transient from rest, one period at a time, until
+    // the state repeats to the same tolerance
+    AnalogCircuit transient("", R, L, C, freq, Vpeak, 1.0 / freq);
+    build(transient);
+    transient.SetTimeStep(pss.Period() / pss.StepsPerPeriod());
+    transient.SetSourceCutoff(HUGE_VAL);
+    transient.timeMax = HUGE_VAL;
+    transient.run();
+    const int maxPeriods = 1000000;
+    int periods = 0;
+    double previous[2] = { 0.0, 0.0 }, x[2];
+    begin = chrono::steady_clock::now();
+    while (periods < maxPeriods) {
+        for (int k = 0; k < pss.StepsPerPeriod(); ++k) transient.runStep();
+        transient.GetState(x[0], x[1]);
+        periods++;
+        double change = 0.0;
+        for (int j = 0; j < 2; ++j)
+            change = max(change, fabs(x[j] - previous[j]) / max(fabs(x[j]) + fabs(previous[j]), 1e-12));
+        previous[0] = x[0];
+        previous[1] = x[1];
+        if (change <= tol) break;
+    }
+    double transientTime = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    cout << "Periodic steady state " << (converged ? "found" : "NOT converged") << ": vC(0) = " << pss.state[0]
+        << " V, iL(0) = " << pss.state[1] << " A, residual " << pss.residual << endl;
+    cout << "Shooting: " << pss.iterations << " Newton iterations, " << pss.integrations << " periods of "
+        << pss.StepsPerPeriod() << " steps in " << elapsed * 1000.0 << " ms" << endl;
+    cout << "Start-up transient: " << periods << (periods >= maxPeriods ? "+" : "") << " periods in "
+        << transientTime * 1000.0 << " ms to repeat within " << tol << endl;
+    cout << "Steady-state period written to " << outFile << endl;
+    return converged ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// Print history help
+static void historyUsage(const char* prog) {
+    cout << "Usage: " << prog << " history [-t seconds] [--policy all|ring|decimate|spill] [-n samples]"
+        << " [--float32] [--step s] [--spill file]" << endl;
+    cout << "  feeds a run into the viewer's drawing history and reports its memory" << endl;
+}
+
+//------------------------------------------------------------------------------
+// history command: memory per simulated second of the viewer's original
+// layout (three double vectors, a double input vector, float times and a
+// pyramid per trace) against WaveformHistory with the chosen retention
+static int runHistory(int argc, char** argv, const char* prog) {
+    double simTime = 10.0, step = 0.0;
+    RetentionPolicy policy = RETAIN_DECIMATE;
+    size_t samples = 1 << 20;
+    bool compact = false;
+    string spillFile = "History.bin";
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { historyUsage(prog); return 0; }
+        else if (!strcmp(opt, "--float32")) compact = true;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; historyUsage(prog); return 1; }
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-n")) samples = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--step")) step = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--spill")) spillFile = argv[++i];
+        else if (!strcmp(opt, "--policy")) {
+            string name = argv[++i];
+            if (name == "all") policy = RETAIN_ALL;
+            else if (name == "ring") policy = RETAIN_RING;
+            else if (name == "decimate") policy = RETAIN_DECIMATE;
+            else if (name == "spill") policy = RETAIN_SPILL;
+            else { cerr << "Error: unknown policy " << name << endl; return 1; }
+        }
+        else { cerr << "Error: unknown option " << opt << endl; historyUsage(prog); return 1; }
+    }
+
+    WaveformHistory history(4);
+    if (!history.Configure(policy, samples, compact, spillFile)) {
+        cerr << "Error: Could not open spill file " << spillFile << endl;
+        return 1;
+    }
+
+    // Original viewer storage, filled the same way it was
+    vector<vector<double>> voltageHistory(3);
+    vector<double> inputHistory;
+    vector<float> timeHistory;
+    EnvelopePyramid envelopes[4];
+    double worstTimeError = 0.0; // Resolution lost by float times
+
+    AnalogCircuit circuit("", 20.0, 0.05, 0.00007, 50.0, 10.0, simTime);
+    circuit.SetVerbose(false);
+    if (step > 0.0) circuit.SetTimeStep(step);
+    circuit.run();
+    auto begin = chrono::steady_clock::now();
+    while (circuit.runStep()) {
+        const Sample& s = circuit.lastSample;
+        double row[4] = { s.vR, s.vC, s.vL, s.vin };
+        history.Append(s.time, row);
+
+        timeHistory.push_back(static_cast<float>(s.time));
+        inputHistory.push_back(s.vin);
+        for (int k = 0; k < 3; ++k) voltageHistory[k].push_back(row[k]);
+        for (int k = 0; k < 4; ++k) envelopes[k].Append(row[k]);
+        worstTimeError = max(worstTimeError, fabs(double(timeHistory.back()) - s.time));
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    size_t oldBytes = timeHistory.capacity() * sizeof(float) + inputHistory.capacity() * sizeof(double);
+    for (auto& v : voltageHistory) oldBytes += v.capacity() * sizeof(double);
+    for (auto& e : envelopes) oldBytes += e.MemoryBytes();
+    size_t newBytes = history.MemoryBytes();
+    const char* names[] = { "all", "ring", "decimate", "spill" };
+
+    cout << circuit.stepCount << " samples over " << simTime << " s simulated (" << elapsed * 1000.0 << " ms)" << endl;
+    cout << "Original layout: " << oldBytes / 1024.0 << " KiB = " << oldBytes / 1024.0 / simTime
+        << " KiB per simulated second, float times off by up to " << worstTimeError << " s" << endl;
+    cout << "WaveformHistory (" << names[policy] << (compact ? ", float32" : "") << "): " << newBytes / 1024.0
+        << " KiB = " << newBytes / 1024.0 / simTime << " KiB per simulated second; " << history.Size()
+        << " samples in memory, " << (history.ImplicitTime() ? "implicit" : "explicit") << " time base, stride "
+        << history.Stride() << ", " << history.Dropped() << (policy == RETAIN_SPILL ? " spilled" : " dropped") << ", "
+        << history.Merged() << " merged" << endl;
+    double peakError = 0.0; // Largest |value| lost from the stored samples
+    for (int k = 0; k < 4; ++k) peakError = max(peakError, envelopes[k].MaxAbs() - history.MaxAbs(k));
+    cout << "Peak |value| lost from the history: " << peakError << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Build an RC ladder driven by a sine source, as heap elements behind the
+// vtable (AddComponent) or stored by value (AddElement)
+static void buildLadder(MnaCircuit& circuit, size_t sections, bool stored) {
+    circuit.AddElement<VoltageSource>("n0", "0", 0.0, 10.0, 50.0, 1.0f, 1.0f, 1.0f, "V1");
+    for (size_t i = 0; i < sections; ++i) {
+        string a = "n" + to_string(i), b = "n" + to_string(i + 1), k = to_string(i);
+        if (stored) {
+            circuit.AddElement<Resistor>(a, b, 1.0, 1.0f, 0.0f, 0.0f, "R" + k);
+            circuit.AddElement<Capacitor>(b, "0", 1e-6, 0.0f, 1.0f, 0.0f, "C" + k);
+        }
+        else {
+            circuit.AddComponent(new Resistor(1.0, 1.0f, 0.0f, 0.0f, "R" + k), a, b);
+            circuit.AddComponent(new Capacitor(1e-6, 0.0f, 1.0f, 0.0f, "C" + k), b, "0");
+        }
+    }
+    circuit.SetTransient(0.0001, 0.01);
+}
+
+//------------------------------------------------------------------------------
+// dispatch command: the same work through Component* virtual calls and
+// through the by-value containers, to show what devirtualisation buys
+static int runDispatch(int argc, char** argv, const char* prog) {
+    long long evals = 20000000;
+    size_t sections = 100000;
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) {
+            cout << "Usage: " << prog << " dispatch [-n evaluations] [-N ladder sections]" << endl;
+            return 0;
+        }
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; return 1; }
+        else if (!strcmp(opt, "-n")) evals = static_cast<long long>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-N")) sections = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else { cerr << "Error: unknown option " << opt << endl; return 1; }
+    }
+
+    auto seconds = [](chrono::steady_clock::time_point begin) {
+        return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    };
+    const double T = 0.0001;
+    volatile double sink = 0.0; // Keeps the loops from being optimised away
+
+    // Series RLC loop sums: heap objects behind Component* (the old layout)
+    // against StaticCircuit, for the heuristic (GetVoltage) and direct (companion) solvers
+    vector<Component*> heap{ new Resistor(20.0, 1.0f, 0.0f, 0.0f, "R1"),
+        new Capacitor(0.00007, 0.0f, 1.0f, 0.0f, "C1"), new Inductor(0.05, 0.0f, 0.0f, 1.0f, "L1") };
+    StaticCircuit<Resistor, Capacitor, Inductor> rlc(Resistor(20.0, 1.0f, 0.0f, 0.0f, "R1"),
+        Capacitor(0.00007, 0.0f, 1.0f, 0.0f, "C1"), Inductor(0.05, 0.0f, 0.0f, 1.0f, "L1"));
+
+    auto begin = chrono::steady_clock::now();
+    for (long long i = 0; i < evals; ++i) {
+        double sumV = 0.0, I = double(i) * 1e-9;
+        for (auto& c : heap) sumV += c->GetVoltage(I, T);
+        sink = sink + sumV;
+    }
+    double voltageVirtual = seconds(begin);
+    begin = chrono::steady_clock::now();
+    for (long long i = 0; i < evals; ++i) sink = sink + rlc.Voltage(double(i) * 1e-9, T);
+    double voltageStatic = seconds(begin);
+
+    begin = chrono::steady_clock::now();
+    for (long long i = 0; i < evals; ++i) {
+        double sumR = 0.0, sumV = 0.0;
+        for (auto& c : heap) {
+            double Req, Veq;
+            c->GetCompanion(T, Req, Veq);
+            sumR += Req;
+            sumV += Veq;
+        }
+        sink = sink + sumR + sumV;
+        heap[1]->Commit(double(i) * 1e-9, T);
+    }
+    double companionVirtual = seconds(begin);
+    begin = chrono::steady_clock::now();
+    for (long long i = 0; i < evals; ++i) {
+        double sumR, sumV;
+        rlc.Companion(T, sumR, sumV);
+        sink = sink + sumR + sumV;
+        rlc.Get<1>().Commit(double(i) * 1e-9, T);
+    }
+    double companionStatic = seconds(begin);
+    for (auto& c : heap) delete c;
+
+    // Netlist steps: the same ladder with heap elements and with stored elements
+    double stepTime[2];
+    for (int stored = 0; stored < 2; ++stored) {
+        MnaCircuit circuit;
+        buildLadder(circuit, sections, stored != 0);
+        circuit.run("");
+        circuit.runStep(); // Analysis and factorization
+        begin = chrono::steady_clock::now();
+        int steps = circuit.runToCompletion() - 1;
+        stepTime[stored] = seconds(begin) / max(steps, 1);
+    }
+
+    cout << "Series loop GetVoltage sum:  virtual " << voltageVirtual / evals * 1e9 << " ns, StaticCircuit "
+        << voltageStatic / evals * 1e9 << " ns (" << voltageVirtual / voltageStatic << "x)" << endl;
+    cout << "Series loop companion sum:   virtual " << companionVirtual / evals * 1e9 << " ns, StaticCircuit "
+        << companionStatic / evals * 1e9 << " ns (" << companionVirtual / companionStatic << "x)" << endl;
+    cout << "Netlist step, " << sections << "-section RC ladder: virtual " << stepTime[0] * 1e3
+        << " ms, ComponentStore " << stepTime[1] * 1e3 << " ms (" << stepTime[0] / stepTime[1] << "x)" << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print Monte Carlo help
+static void monteCarloUsage(const char* prog) {
+    cout << "Usage: " << prog << " montecarlo [-R ohms] [-L henries] [-C farads] [-f hz] [-V volts] [-t seconds]"
+        << " [--tol x] [--tol-R x] [--tol-L x] [--tol-C x] [--dist uniform|normal] [-n trials] [-j threads]"
+        << " [--seed n] [--vc-limit volts] [-o prefix]" << endl;
+    cout << "  tolerances are relative (0.05 = 5%); normal puts 3 sigma at the tolerance" << endl;
+    cout << "  writes <prefix>R1.dat, C1.dat and L1.dat: mean, deviation, min, max and quantiles per step" << endl;
+}
+
+//------------------------------------------------------------------------------
+// montecarlo command: random R, L, C per trial, statistics of every time step
+// folded in as the trials run
+static int runMonteCarlo(int argc, char** argv, const char* prog) {
+    double R = 20.0, L = 0.05, C = 0.00007, freq = 50.0, Vpeak = 10.0, simTime = 0.1;
+    double tol = 0.05, tolR = -1.0, tolL = -1.0, tolC = -1.0, limit = 0.0;
+    ToleranceShape shape = TOL_UNIFORM;
+    size_t trials = 10000;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    string prefix = "MonteCarlo_";
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { monteCarloUsage(prog); return 0; }
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; monteCarloUsage(prog); return 1; }
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-f")) freq = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--tol")) tol = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--tol-R")) tolR = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--tol-L")) tolL = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--tol-C")) tolC = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--vc-limit")) limit = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-n")) trials = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-j")) threads = static_cast<unsigned>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--seed")) seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(opt, "-o")) prefix = argv[++i];
+        else if (!strcmp(opt, "--dist")) {
+            string name = argv[++i];
+            if (name == "uniform") shape = TOL_UNIFORM;
+            else if (name == "normal") shape = TOL_NORMAL;
+            else { cerr << "Error: unknown distribution " << name << endl; return 1; }
+        }
+        else { cerr << "Error: unknown option " << opt << endl; monteCarloUsage(prog); return 1; }
+    }
+    if (trials == 0) { cerr << "Error: montecarlo needs at least one trial" << endl; return 1; }
+
+    MonteCarlo mc(Tolerance{ R, tolR >= 0.0 ? tolR : tol, shape }, Tolerance{ L, tolL >= 0.0 ? tolL : tol, shape },
+        Tolerance{ C, tolC >= 0.0 ? tolC : tol, shape }, freq, Vpeak, simTime, seed);
+    mc.SetPeakLimit(limit);
+    auto begin = chrono::steady_clock::now();
+    mc.Run(trials, threads);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (!mc.WriteEnvelopes(prefix)) return 1;
+
+    mc.WriteSummary(cout);
+    cout << mc.Trials() << " trials of " << mc.Steps() << " steps in " << elapsed << " s ("
+        << mc.Trials() / elapsed << " trials/s), " << mc.MemoryBytes() / 1024.0 << " KiB of statistics" << endl;
+    cout << "Envelopes written to " << prefix << "R1.dat, " << prefix << "C1.dat and " << prefix << "L1.dat" << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print batch help
+static void batchUsage(const char* prog) {
+    cout << "Usage: " << prog << " batch <job file> [-j threads] [--cache dir] [--cache-size MiB] [-o summary]" << endl;
+    cout << "  one job per line: R=20 L=0.05 C=7e-5 f=50 V=10 t=0.1 solver=direct step=1e-4 out=Job.dat" << endl;
+    cout << "  (fields optional); a repeat shares one run, configurations from earlier batches come from the cache" << endl;
+}
+
+//------------------------------------------------------------------------------
+// batch command: run a job file, simulating only what the cache lacks
+static int runBatch(int argc, char** argv, const char* prog) {
+    string jobFile, cacheDir = ".anasim-cache", summaryFile = "Batch.dat";
+    double cacheMiB = 1024.0;
+    unsigned threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { batchUsage(prog); return 0; }
+        else if (opt[0] != '-' && jobFile.empty()) jobFile = opt;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; batchUsage(prog); return 1; }
+        else if (!strcmp(opt, "-j")) threads = static_cast<unsigned>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--cache")) cacheDir = argv[++i];
+        else if (!strcmp(opt, "--cache-size")) cacheMiB = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-o")) summaryFile = argv[++i];
+        else { cerr << "Error: unknown option " << opt << endl; batchUsage(prog); return 1; }
+    }
+    if (jobFile.empty()) { batchUsage(prog); return 1; }
+
+    BatchRunner batch(cacheDir, static_cast<uint64_t>(max(cacheMiB, 0.0) * 1048576.0));
+    if (!batch.Load(jobFile)) return 1;
+    bool ok = batch.Run(threads);
+    batch.WriteSummary(summaryFile);
+    batch.Report(cout);
+    cout << "Summary written to " << summaryFile << endl;
+    return ok ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// Print ladder help
+static void ladderUsage(const char* prog) {
+    cout << "Usage: " << prog << " ladder [-N sections] [-R ohms] [-L henries] [-C farads] [--load ohms]"
+        << " [--spread x] [--seed n] [-f hz] [-V volts] [--step s] [-t seconds] [-j threads]"
+        << " [-o file] [--netlist file] [--baseline]" << endl;
+    cout << "  R, L and C are per section (default 10000 sections of 0.1 ohm, 10 uH, 10 nF, 1 kHz,"
+        << " step 1 us, 10 ms); load defaults to sqrt(L/C), 0 = open end" << endl;
+    cout << "  --spread scatters every element by up to +-x; --netlist also writes the circuit for the"
+        << " netlist command; --baseline first runs on one thread and reports the speedup" << endl;
+}
+
+//------------------------------------------------------------------------------
+// ladder command: long RLC chain, partitioned across threads
+static int runLadder(int argc, char** argv, const char* prog) {
+    double R = 0.1, L = 1e-5, C = 1e-8, load = -1.0, spread = 0.0, freq = 1000.0, Vpeak = 1.0;
+    double step = 1e-6, simTime = 0.01;
+    size_t sections = 10000;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    bool baseline = false;
+    string outFile = "Ladder.dat", netlistFile;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { ladderUsage(prog); return 0; }
+        else if (!strcmp(opt, "--baseline")) baseline = true;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; ladderUsage(prog); return 1; }
+        else if (!strcmp(opt, "-N")) sections = static_cast<size_t>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--load")) load = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--spread")) spread = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--seed")) seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(opt, "-f")) freq = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--step")) step = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-j")) threads = static_cast<unsigned>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else if (!strcmp(opt, "--netlist")) netlistFile = argv[++i];
+        else { cerr << "Error: unknown option " << opt << endl; ladderUsage(prog); return 1; }
+    }
+    if (sections < 1 || R < 0.0 || L <= 0.0 || C <= 0.0 || step <= 0.0) {
+        cerr << "Error: ladder needs at least one section, L > 0, C > 0 and a positive step" << endl;
+        return 1;
+    }
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    LadderNetwork ladder(sections, R, L, C, load, freq, Vpeak);
+    if (spread > 0.0) ladder.Spread(spread, seed);
+    vector<size_t> probes{ 0, sections / 4, sections / 2, 3 * sections / 4, sections };
+    probes.erase(unique(probes.begin(), probes.end()), probes.end());
+    if (!netlistFile.empty()) {
+        if (!ladder.WriteNetlist(netlistFile, step, simTime, probes)) return 1;
+        cout << "Netlist written to " << netlistFile << endl;
+    }
+
+    double serial = 0.0;
+    if (baseline) {
+        PartitionedTransient single(ladder, step, 1);
+        if (!single.Run(simTime, "", probes)) return 1;
+        serial = single.Seconds();
+    }
+    PartitionedTransient engine(ladder, step, threads);
+    if (!engine.Run(simTime, outFile, probes)) return 1;
+
+    double sectionSteps = double(sections) * engine.Steps();
+    cout << sections << "-section ladder, " << engine.Steps() << " steps on " << engine.Partitions()
+        << " partition(s) in " << engine.Seconds() << " s (" << engine.Seconds() / max<size_t>(engine.Steps(), 1) * 1e6
+        << " us per step, " << sectionSteps / engine.Seconds() / 1e6 << " M section-steps/s)" << endl;
+    if (baseline)
+        cout << "One partition: " << serial << " s, speedup " << serial / engine.Seconds() << "x" << endl;
+    cout << "Results written to " << outFile << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    // Sub-commands take the remaining arguments
+    if (argc > 1 && !strcmp(argv[1], "sweep")) return runSweep(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "ensemble")) return runEnsemble(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "netlist")) return runNetlist(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "history")) return runHistory(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "pss")) return runPss(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "montecarlo")) return runMonteCarlo(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "batch")) return runBatch(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "ladder")) return runLadder(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "ac")) return runAc(argc - 1, argv + 1, argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "dispatch")) return runDispatch(argc - 1, argv + 1, argv[0]);
+
+    // Defaults match the interactive viewer
+    double R = 20.0; // Ohms
+    double L = 0.05; // Henries
+    double C = 0.00007; // Farads
+    double freq = 50.0; // Hz
+    double Vpeak = 10.0; // Volts
+    double simTime = 0.1; // seconds
+    string outFile = "RLC.dat";
+    SolverMode solver = SOLVER_DIRECT;
+    bool verbose = false;
+    int flushRows = 0;
+    int archiveBits = 0;
+    bool adaptive = false;
+    double relTol = 1e-3, absTol = 1e-6, maxStep = 0.0;
+    double step = 0.0; // 0 = the core's default
+    bool diode = false;
+    double lsat = 0.0, isat = 1.0;
+    string checkpointFile, resumeFile;
+    int checkpointEvery = 1000;
+    int stopAfter = 0; // 0 = run to the end
+    string statsFile;
+    double statsEvery = 0.0; // Seconds between live reports, 0 = none
+    string pwlFile, pulseSpec, toneSpec, waveFile;
+    double waveRate = 0.0, waveGain = 1.0;
+    bool waveDouble = false;
+    string analyticsFile, windowSpec;
+    int harmonics = 10;
+    bool noTrace = false;
+
+    // A resumed run starts from the snapshot's values, the options below override them
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--resume")) continue;
+        resumeFile = argv[i + 1];
+        if (!AnalogCircuit::ReadCheckpointParameters(resumeFile, R, L, C, freq, Vpeak, simTime, outFile)) return 1;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { usage(argv[0]); return 0; }
+        else if (!strcmp(opt, "-v")) verbose = true;
+        else if (!strcmp(opt, "--adaptive")) adaptive = true;
+        else if (!strcmp(opt, "--diode")) diode = true;
+        else if (!strcmp(opt, "--wave-f64")) waveDouble = true;
+        else if (!strcmp(opt, "--no-trace")) noTrace = true;
+        else if (!hasValue) { cerr << "Error: missing value for " << opt << endl; usage(argv[0]); return 1; }
+        else if (!strcmp(opt, "-R")) R = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-L")) L = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-C")) C = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-f")) freq = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-V")) Vpeak = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-t")) simTime = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else if (!strcmp(opt, "--flush-rows")) flushRows = static_cast<int>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--archive-bits")) archiveBits = static_cast<int>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--reltol")) relTol = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--abstol")) absTol = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--max-step")) maxStep = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--step")) step = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--lsat")) lsat = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--isat")) isat = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--checkpoint")) checkpointFile = argv[++i];
+        else if (!strcmp(opt, "--checkpoint-every")) checkpointEvery = static_cast<int>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--resume")) ++i; // Read above
+        else if (!strcmp(opt, "--stop-after")) stopAfter = static_cast<int>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--stats")) statsFile = argv[++i];
+        else if (!strcmp(opt, "--stats-every")) statsEvery = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--analytics")) analyticsFile = argv[++i];
+        else if (!strcmp(opt, "--analytics-window")) windowSpec = argv[++i];
+        else if (!strcmp(opt, "--harmonics")) harmonics = static_cast<int>(parseValue(opt, argv[++i]));
+        else if (!strcmp(opt, "--pwl")) pwlFile = argv[++i];
+        else if (!strcmp(opt, "--pulse")) pulseSpec = argv[++i];
+        else if (!strcmp(opt, "--tones")) toneSpec = argv[++i];
+        else if (!strcmp(opt, "--wave")) waveFile = argv[++i];
+        else if (!strcmp(opt, "--wave-rate")) waveRate = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--wave-gain")) waveGain = parseValue(opt, argv[++i]);
+        else if (!strcmp(opt, "--solver")) {
+            string name = argv[++i];
+            if (name == "direct") solver = SOLVER_DIRECT;
+            else if (name == "heuristic") solver = SOLVER_HEURISTIC;
+            else if (name == "newton") solver = SOLVER_NEWTON;
+            else if (name == "exact") solver = SOLVER_EXACT;
+            else { cerr << "Error: unknown solver " << name << endl; return 1; }
+        }
+        else { cerr << "Error: unknown option " << opt << endl; usage(argv[0]); return 1; }
+    }
+    if (noTrace) outFile.clear();
+
+    // A resumed run opens its data file from the snapshot, truncated or copied to the saved length
+    AnalogCircuit circuit(resumeFile.empty() ? outFile : string(), R, L, C, freq, Vpeak, simTime);
+    circuit.SetSolver(solver);
+    if (diode) circuit.AddComponent(new Diode(1e-14, 1.0, 1.0f, 1.0f, 0.0f, "D1"));
+    if (lsat > 0.0) circuit.AddComponent(new SaturableInductor(lsat, isat, 0.0f, 1.0f, 1.0f, "LS1"));
+    if (solver == SOLVER_EXACT && (diode || lsat > 0.0))
+        cerr << "Warning: nonlinear elements, the exact solver falls back to direct" << endl;
+
+    // Source waveform, the switched sine unless one of these is given
+    if (!pwlFile.empty()) {
+        PwlStimulus* pwl = new PwlStimulus();
+        circuit.SetStimulus(pwl);
+        if (!pwl->Load(pwlFile)) return 1;
+    }
+    else if (!pulseSpec.empty()) {
+        vector<double> p = parseNumbers("--pulse", pulseSpec, ',');
+        if (p.size() != 7) { cerr << "Error: --pulse needs v1,v2,delay,rise,fall,width,period" << endl; return 1; }
+        circuit.SetStimulus(new PulseStimulus(p[0], p[1], p[2], p[3], p[4], p[5], p[6]));
+    }
+    else if (!toneSpec.empty()) {
+        MultiToneStimulus* tones = new MultiToneStimulus();
+        circuit.SetStimulus(tones);
+        istringstream list(toneSpec);
+        string tone;
+        while (getline(list, tone, ',')) {
+            vector<double> t = parseNumbers("--tones", tone, ':');
+            if (t.size() < 2 || t.size() > 3) { cerr << "Error: --tones needs amplitude:frequency[:degrees],..." << endl; return 1; }
+            tones->AddTone(t[0], t[1], t.size() > 2 ? t[2] : 0.0);
+        }
+    }
+    else if (!waveFile.empty()) {
+        SampleFileStimulus* wave = new SampleFileStimulus();
+        circuit.SetStimulus(wave);
+        if (!wave->Open(waveFile, waveRate, waveDouble, waveGain)) return 1;
+        if (verbose) cout << waveFile << ": " << wave->Samples() << " samples, " << wave->Duration() << " s" << endl;
+    }
+    bool stimulus = !pwlFile.empty() || !pulseSpec.empty() || !toneSpec.empty() || !waveFile.empty();
+    if (solver == SOLVER_EXACT && stimulus)
+        cerr << "Warning: stimulus source, the exact solver falls back to direct" << endl;
+
+    // Metrics over whole periods of the steady drive, before the sine switches off
+    WaveformAnalytics analytics(freq, harmonics);
+    if (!analyticsFile.empty()) {
+        if (!windowSpec.empty()) {
+            vector<double> w = parseNumbers("--analytics-window", windowSpec, ':');
+            if (w.size() != 2 || w[1] <= w[0]) { cerr << "Error: --analytics-window needs from:to" << endl; return 1; }
+            analytics.SetWindow(w[0], w[1]);
+        }
+        else {
+            double end = stimulus ? simTime : 0.6 * simTime;
+            double periods = min(10.0, floor(end * freq + 1e-9));
+            analytics.SetWindow(periods >= 1.0 ? end - periods / freq : 0.0, end);
+        }
+        circuit.SetAnalytics(&analytics);
+    }
+    if (step > 0.0) circuit.SetTimeStep(step);
+    circuit.SetVerbose(verbose);
+    if (flushRows > 0) circuit.SetFlushPolicy(FLUSH_EVERY_ROWS, flushRows);
+    if (archiveBits > 0) circuit.SetArchiveBits(archiveBits);
+    if (adaptive) circuit.SetAdaptive(true, relTol, absTol, maxStep);
+    if (!checkpointFile.empty()) circuit.SetCheckpoint(checkpointFile, checkpointEvery);
+    if (!resumeFile.empty()) {
+        if (!circuit.LoadCheckpoint(resumeFile, outFile)) return 1;
+        cout << "Resumed from " << resumeFile << " at step " << circuit.stepCount
+            << ", t = " << circuit.currentTime << " s." << endl;
+    }
+
+    // Live counters are read from another thread while the run goes on
+    atomic<bool> finished(false);
+    thread reporter;
+    if (statsEvery > 0.0) {
+        reporter = thread([&] {
+            auto next = chrono::steady_clock::now() + chrono::duration<double>(statsEvery);
+            while (!finished) {
+                this_thread::sleep_for(chrono::milliseconds(10));
+                if (chrono::steady_clock::now() < next) continue;
+                cerr << circuit.stats.Summary() << endl;
+                next += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(statsEvery));
+            }
+        });
+    }
+
+    // Whole transient in one tight loop, no frame pacing
+    auto begin = chrono::steady_clock::now();
+    circuit.run();
+    int steps;
+    if (stopAfter > 0) {
+        while (circuit.stepCount < stopAfter && circuit.runStep()) {}
+        steps = circuit.stepCount;
+    }
+    else steps = circuit.runToCompletion();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    finished = true;
+    if (reporter.joinable()) reporter.join();
+
+    cout << (circuit.simulationComplete ? "Simulation completed. " : "Simulation stopped. ") << steps
+        << " time steps executed in " << elapsed * 1000.0 << " ms." << endl;
+    if (adaptive) cout << "Adaptive stepping: " << circuit.rejectedSteps << " steps rejected." << endl;
+    if (solver == SOLVER_HEURISTIC || solver == SOLVER_NEWTON) {
+        cout << "Solver iterations: " << circuit.solverIterations << " total, "
+            << double(circuit.solverIterations) / max(steps, 1) << " per step, "
+            << circuit.maxStepIterations << " at most in one step." << endl;
+    }
+    if (!circuit.CloseOutput()) return 1;
+    if (!outFile.empty()) cout << "Data written to " << outFile << endl;
+    if (!statsFile.empty() && !circuit.stats.WriteJson(statsFile)) return 1;
+    if (!analyticsFile.empty() && !analytics.WriteSummary(analyticsFile)) return 1;
+    return 0;
+}
@@ -0,0 +1,156 @@
+// AnalogCircuitDump.cpp - Reader and converter for compressed trace archives
+//
+// Usage: AnalogCircuitDump <file.rlcz> [--from t] [--to t] [-o file.dat] [--info]
+//        AnalogCircuitDump <file.dat> -o <file.rlcz> [--bits n]
+//
+// The first form prints the rows with from <= time <= to in the RLC.dat text
+// layout (to stdout unless -o names a file); only the chunks overlapping the
+// window are read. --info prints the archive's columns, size and time span
+// instead. The second form converts a text data file into an archive,
+// keeping n mantissa bits of each value (default 24, 52 = exact).
+
+#include "TraceArchive.h" // Archive reader
+#include "TraceWriter.h" // Text and archive output
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+static void usage(const char* prog) {
+    cout << "Usage: " << prog << " <file.rlcz> [--from t] [--to t] [-o file.dat] [--info]" << endl;
+    cout << "       " << prog << " <file.dat> -o <file.rlcz> [--bits n]" << endl;
+}
+
+//------------------------------------------------------------------------------
+// Text data file -> archive
+static int convert(const string& inFile, const string& outFile, int bits) {
+    ifstream in(inFile);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open " << inFile << endl;
+        return 1;
+    }
+    string line;
+    vector<string> names;
+    if (getline(in, line)) {
+        istringstream fields(line);
+        for (string name; fields >> name;) names.push_back(name);
+    }
+    if (names.empty()) {
+        cerr << "Error: " << inFile << " has no header row" << endl;
+        return 1;
+    }
+
+    TraceWriter writer;
+    writer.SetArchiveBits(bits);
+    if (!writer.Open(outFile)) {
+        cerr << "Error: Could not open output file " << outFile << endl;
+        return 1;
+    }
+    writer.WriteHeader(names);
+    vector<double> row(names.size());
+    size_t rows = 0;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        size_t k = 0;
+        while (k < row.size() && fields >> row[k]) k++;
+        if (k == 0) continue;
+        if (k != row.size()) {
+            cerr << "Error: " << inFile << " row " << rows + 1 << " has " << k << " values" << endl;
+            return 1;
+        }
+        writer.WriteRow(row.data(), static_cast<int>(row.size()));
+        rows++;
+    }
+    if (!writer.Close()) {
+        cerr << "Error: Could not write " << outFile << endl;
+        return 1;
+    }
+    error_code failed;
+    uintmax_t before = filesystem::file_size(inFile, failed), after = filesystem::file_size(outFile, failed);
+    cout << rows << " rows: " << before << " -> " << after << " bytes (" << double(before) / after << "x)" << endl;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    string inFile, outFile;
+    double from = -HUGE_VAL, to = HUGE_VAL;
+    bool info = false;
+    int bits = 24;
+    for (int i = 1; i < argc; ++i) {
+        const char* opt = argv[i];
+        if (!strcmp(opt, "-h") || !strcmp(opt, "--help")) { usage(argv[0]); return 0; }
+        else if (!strcmp(opt, "--info")) info = true;
+        else if (opt[0] != '-' && inFile.empty()) inFile = opt;
+        else if (i + 1 >= argc) { cerr << "Error: missing value for " << opt << endl; return 1; }
+        else if (!strcmp(opt, "--from")) from = atof(argv[++i]);
+        else if (!strcmp(opt, "--to")) to = atof(argv[++i]);
+        else if (!strcmp(opt, "--bits")) bits = atoi(argv[++i]);
+        else if (!strcmp(opt, "-o")) outFile = argv[++i];
+        else { cerr << "Error: unknown option " << opt << endl; usage(argv[0]); return 1; }
+    }
+    if (inFile.empty()) { usage(argv[0]); return 1; }
+    if (!IsArchiveName(inFile)) {
+        if (!IsArchiveName(outFile)) {
+            cerr << "Error: converting a text file needs -o <file.rlcz>" << endl;
+            return 1;
+        }
+        return convert(inFile, outFile, bits);
+    }
+
+    TraceArchiveReader reader;
+    if (!reader.Open(inFile)) return 1;
+    if (info) {
+        error_code failed;
+        uintmax_t bytes = filesystem::file_size(inFile, failed);
+        size_t rows = reader.Rows();
+        cout << inFile << ": " << rows << " rows of";
+        for (const auto& name : reader.Names()) cout << " " << name;
+        cout << endl << reader.Chunks() << " chunks, " << (reader.Indexed() ? "indexed" : "no index (recovered by scan)")
+            << ", time " << reader.StartTime() << " to " << reader.EndTime() << " s" << endl;
+        cout << bytes << " bytes, " << (rows ? double(bytes) / rows : 0.0) << " bytes per row ("
+            << 12 * reader.Columns() + 1 << " as text), values keep " << reader.ValueBits() << " mantissa bits" << endl;
+        return 0;
+    }
+
+    vector<double> values;
+    auto begin = chrono::steady_clock::now();
+    if (!reader.Read(from, to, values)) return 1;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    size_t columns = reader.Columns(), rows = values.size() / columns;
+
+    if (outFile.empty()) {
+        for (const auto& name : reader.Names()) printf("%12s", name.c_str());
+        printf("\n");
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < columns; ++c) printf("%12g", values[r * columns + c]);
+            printf("\n");
+        }
+        return 0;
+    }
+    TraceWriter writer;
+    if (!writer.Open(outFile)) {
+        cerr << "Error: Could not open output file " << outFile << endl;
+        return 1;
+    }
+    writer.WriteHeader(reader.Names());
+    for (size_t r = 0; r < rows; ++r) writer.WriteRow(&values[r * columns], static_cast<int>(columns));
+    if (!writer.Close()) {
+        cerr << "Error: Could not write " << outFile << endl;
+        return 1;
+    }
+    cerr << rows << " rows decoded in " << elapsed * 1000.0 << " ms ("
+        << rows * columns * sizeof(double) / elapsed / 1e6 << " MB/s of doubles), written to " << outFile << endl;
+    return 0;
+}
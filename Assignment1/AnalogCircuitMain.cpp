@@ -4,77 +4,72 @@
 #include <GL/glut.h>
 #include <algorithm>  // For std::max
 #include <cmath>      // For std::abs
+#include <cstdlib>    // For strtoul
+#include <string>
+#include <GL/freeglut.h> // For glutBitmapString
 #include "AnalogCircuit.h"
+#include "AnalogCircuitViewer.h" // Viewer globals, history and simulation driver
+#include "WaveformHistory.h" // Bounded history with level-of-detail reduction
 
 using namespace std;
 
-// External global variables
-extern int windowWidth; //Width of the OpenGL window
-extern int windowHeight; //Height of the OpenGL window
-extern double scalingFactor; //Scaling factor for drawing components
-extern AnalogCircuit* currentCircuit; // Pointer to current circuit
-
-// External simulation functions
-extern bool isSimulationRunning(); // Check if simulation is running
-extern bool isSimulationComplete(); // Check if simulation is complete
-extern void simulationStep(); // Perform one simulation step
-
-// External history globals for drawing 
-extern std::vector<std::vector<double>> voltageHistory;
-extern std::vector<double> inputHistory;  
-extern std::vector<float> timeHistory;
-
 // Display callback function 
 void display() {
     // Clear with black background to match expected
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    // Pick up whatever the simulation thread produced since the last frame
+    // (timed as history), then time the drawing
+    drainSamples();
+    uint64_t frameStart = Instrumentation::Now();
+
     // Draw the circuit visualization
     // no grid in expected image
-    AnalogCircuit::drawAxes();
+    drawAxes();
 
     // FIXED: Draw voltage traces from history if simulation has started
-    if (currentCircuit && (isSimulationRunning() || isSimulationComplete()) && !timeHistory.empty()) {
-        // Compute dynamic scale factor 
-        float maxVoltage = static_cast<float>(currentCircuit->Vpeak);  // Start with Vpeak
-        // Compute actual max for better fit 
-        float actualMax = static_cast<float>(currentCircuit->Vpeak);
-        for (int i = 0; i < 3; ++i) {
-            for (double v : voltageHistory[i]) {
-                float absV = static_cast<float>(fabs(v));  // Use fabs for double to avoid macro issues
-                if (absV > actualMax) actualMax = absV;
-            }
-        }
-        // Include input history in max calculation
-        for (double v : inputHistory) {
-            float absV = static_cast<float>(fabs(v));  // Use fabs for double
-            if (absV > actualMax) actualMax = absV;
+    if (currentCircuit && (isSimulationRunning() || isSimulationComplete()) && waveformHistory.Size() > 0) {
+        // Compute dynamic scale factor from the running max-abs of every trace
+        float actualMax = static_cast<float>(currentCircuit->Vpeak);  // Start with Vpeak
+        for (int i = 0; i < 4; ++i) {
+            actualMax = max(actualMax, static_cast<float>(waveformHistory.MaxAbs(i)));
         }
-        maxVoltage = actualMax * 1.1f;  // Small margin
+        float maxVoltage = actualMax * 1.1f;  // Small margin
 
         float scaleFactor = (windowHeight / 2.0f - 50.0f) / maxVoltage;
 
-        // Component colors: Red (R), Green (C), Blue (L)
-        float colors[3][3] = {
+        // Component colors: Red (R), Green (C), Blue (L), then White for the input
+        float colors[4][3] = {
             {1.0f, 0.0f, 0.0f},  // Red for R
             {0.0f, 1.0f, 0.0f},  // Green for C
-            {0.0f, 0.0f, 1.0f}   // Blue for L
+            {0.0f, 0.0f, 1.0f},  // Blue for L
+            {1.0f, 1.0f, 1.0f}   // White for input
         };
 
-        for (int comp = 0; comp < 3; ++comp) {
-            if (voltageHistory[comp].empty()) continue;
+        // One column per pixel between the 50 px margins; each trace is reduced
+        // to its min/max per column so vertex count does not grow with steps
+        int columns = max(1, windowWidth - 100);
+        static vector<float> xs; // Reused between frames
+        static vector<double> vs;
+
+        // The plot starts at the oldest retained sample (0 unless a ring dropped some)
+        double tStart = waveformHistory.Time(0);
+        for (int trace = 0; trace < 4; ++trace) {
+            xs.clear();
+            vs.clear();
+            waveformHistory.Columns(trace, tStart, currentCircuit->timeMax, columns, xs, vs);
 
-            glColor3f(colors[comp][0], colors[comp][1], colors[comp][2]);
+            glColor3f(colors[trace][0], colors[trace][1], colors[trace][2]);
             glLineWidth(2.0f);
             glBegin(GL_LINE_STRIP);
 
-            for (size_t j = 0; j < timeHistory.size(); ++j) {
-                // X based on time
-                float x = 50.0f + (timeHistory[j] / static_cast<float>(currentCircuit->timeMax)) * (windowWidth - 100.0f);
+            for (size_t j = 0; j < xs.size(); ++j) {
+                // X from the pixel column
+                float x = 50.0f + xs[j];
 
                 // Y based on voltage
-                float y = (windowHeight / 2.0f) + static_cast<float>(voltageHistory[comp][j]) * scaleFactor;
+                float y = (windowHeight / 2.0f) + static_cast<float>(vs[j]) * scaleFactor;
 
                 // Clamp to bounds with margin
                 if (y < 50.0f) y = 50.0f;
@@ -86,30 +81,6 @@ void display() {
             glEnd();
         }
         glLineWidth(1.0f);
-
-        // ADDED: Draw input voltage waveform in white
-        if (!inputHistory.empty()) {
-            glColor3f(1.0f, 1.0f, 1.0f);  // White for input
-            glLineWidth(2.0f);
-            glBegin(GL_LINE_STRIP);
-
-            for (size_t j = 0; j < timeHistory.size(); ++j) {
-                // X based on time
-                float x = 50.0f + (timeHistory[j] / static_cast<float>(currentCircuit->timeMax)) * (windowWidth - 100.0f);
-
-                // Y based on input voltage
-                float y = (windowHeight / 2.0f) + static_cast<float>(inputHistory[j]) * scaleFactor;
-
-                // Clamp to bounds with margin
-                if (y < 50.0f) y = 50.0f;
-                if (y > windowHeight - 50.0f) y = windowHeight - 50.0f;
-
-                glVertex2f(x, y);
-            }
-
-            glEnd();
-            glLineWidth(1.0f);
-        }
     }
 
     // Display simulation status in white at bottom right corner of the page
@@ -149,6 +120,10 @@ void display() {
     glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"-");
 
     glutSwapBuffers();
+    if (currentCircuit) {
+        currentCircuit->stats.AddPhase(PHASE_RENDER, frameStart);
+        currentCircuit->stats.Count(STAT_FRAMES);
+    }
 }
 
 // Window resize handler
@@ -170,17 +145,42 @@ void idle() {
     glutPostRedisplay();
 }
 
-// Keyboard handler for exit
+// Keyboard handler: exit, or print the live statistics
 void keyboard(unsigned char key, int x, int y) {
     if (key == 27 || key == 'q' || key == 'Q') { // ESC or Q
-        delete currentCircuit;  
+        stopSimulation();
         exit(0);
     }
+    if (key == 's' || key == 'S') printStats();
 }
 
 int main(int argc, char** argv) {
     // Initialize GLUT
     glutInit(&argc, argv);
+
+    // Remaining arguments: --threaded steps the simulation on a worker thread;
+    // --history all|ring|decimate|spill, --history-samples n and --history-double
+    // choose how the drawing history is retained; --stats file writes the run
+    // statistics as JSON at the end (the S key prints them at any time)
+    RetentionPolicy policy = RETAIN_DECIMATE;
+    size_t historySamples = 1 << 20;
+    bool compact = true;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threaded") setThreadedMode(true);
+        else if (arg == "--history-double") compact = false;
+        else if (arg == "--stats" && i + 1 < argc) setStatsFile(argv[++i]);
+        else if (arg == "--history-samples" && i + 1 < argc) historySamples = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--history" && i + 1 < argc) {
+            string name = argv[++i];
+            if (name == "all") policy = RETAIN_ALL;
+            else if (name == "ring") policy = RETAIN_RING;
+            else if (name == "decimate") policy = RETAIN_DECIMATE;
+            else if (name == "spill") policy = RETAIN_SPILL;
+            else cerr << "Warning: unknown history policy " << name << endl;
+        }
+    }
+    setHistoryPolicy(policy, historySamples, compact);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
 
     // Set window parameters like in sample
@@ -0,0 +1,320 @@
+// AnalogCircuitViewer.cpp - GLUT front end for the ANASIM simulation core
+
+#include "AnalogCircuitViewer.h" // Viewer globals and callbacks
+#include "AnalogCircuit.h" // Simulation core
+#include "SampleRing.h" // Lock-free queue between simulation thread and display
+
+#ifdef _WIN32
+#include <Windows.h> // Windows API for message handling
+#undef max  // Undefine Windows max macro to avoid conflict with std::max
+#undef min  // Undefine Windows min macro as well
+#endif
+#include <GL/glut.h> // GLUT for windowing and input
+#include <GL/freeglut.h> // FreeGLUT extension for glutBitmapString
+#include <atomic>
+#include <iostream>
+#include <sstream>    // For istringstream
+#include <thread>
+
+using namespace std;
+
+// Global variables definition
+int windowWidth = 1000; // Width of the OpenGL window
+int windowHeight = 600; //  Height of the OpenGL window
+double scalingFactor = 1.0;     // Scaling factor for drawing components
+
+// Global voltage history storage: the whole run at up to 1M float samples,
+// halving its resolution as it fills (see setHistoryPolicy)
+WaveformHistory waveformHistory(4, RETAIN_DECIMATE, 1 << 20, true);
+
+// Global simulation state (atomic because the worker thread finishes the run)
+static atomic<bool> globalSimulationRunning(false); // True while any simulation is active
+static atomic<bool> globalSimulationComplete(false); //    True when simulation has finished
+AnalogCircuit* currentCircuit = nullptr; // Pointer to current circuit
+
+// Worker thread mode: the simulation steps on its own thread and streams
+// samples through the ring; only the display side touches the histories
+static bool threadedMode = false; // Selected before start()
+static thread worker; // Simulation thread
+static atomic<bool> workerStop(false); // Request the worker to exit early
+static atomic<bool> workerDone(false); // Worker has produced its last sample
+static SampleRing<Sample> sampleRing(1 << 16); // Samples waiting for the display
+static string statsFile; // JSON run statistics written at the end, empty = none
+
+
+// Windows message pump for responsive GUI, installed into the core as a hook
+static void PumpMessages() {
+#ifdef _WIN32
+    MSG msg;
+    while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Simulation thread body: step continuously and publish every sample
+static void simulationWorker(AnalogCircuit* circuit) {
+    while (!workerStop && circuit->runStep()) {
+        // Ring full means the display is behind, wait rather than drop samples
+        while (!sampleRing.push(circuit->lastSample)) {
+            if (workerStop) break;
+            this_thread::yield();
+        }
+    }
+    workerDone = true;
+}
+
+//------------------------------------------------------------------------------
+// Select how much drawing history is kept, must be called before start()
+void setHistoryPolicy(RetentionPolicy policy, size_t samples, bool compact) {
+    if (!waveformHistory.Configure(policy, samples, compact))
+        cerr << "Warning: could not open the history spill file" << endl;
+}
+
+//------------------------------------------------------------------------------
+// Write the run statistics to this file when the simulation completes
+void setStatsFile(const string& filename) {
+    statsFile = filename;
+}
+
+//------------------------------------------------------------------------------
+// Live counters on demand, safe while the worker is stepping
+void printStats() {
+    if (currentCircuit) cout << currentCircuit->stats.Summary() << endl;
+}
+
+//------------------------------------------------------------------------------
+// Completion message shared by both stepping modes
+static void reportCompletion() {
+    cout << "Simulation completed. " << currentCircuit->stepCount << " time steps executed." << endl;
+    if (currentCircuit->CloseOutput()) cout << "Data written to RLC.dat" << endl;
+    if (!statsFile.empty() && currentCircuit->stats.WriteJson(statsFile))
+        cout << "Statistics written to " << statsFile << endl;
+}
+
+//------------------------------------------------------------------------------
+// Select worker thread mode, must be called before start()
+void setThreadedMode(bool on) {
+    threadedMode = on;
+}
+
+//  ------------------------------------------------------------------------------
+void start() {
+	// Display simulation information
+    cout << "ANASIM - Analog Circuit Simulator" << endl;
+    cout << "=================================" << endl;
+
+    // Defaults
+	double R = 20.0; // Ohms
+	double L = 0.05; // Henries
+	double C = 0.00007; // Farads
+	double freq = 50.0; // Hz
+	double Vpeak = 10.0; // Volts
+	double simTime = 0.1; // seconds
+
+    // Get user input for circuit parameters with defaults on blank/empty input
+    cout << "Enter resistor value (ohms) [default " << R << "]: "; 
+	string inputLine; // input line
+    getline(cin, inputLine);
+    if (inputLine.empty() || !(istringstream(inputLine) >> R)) {
+        R = 20.0;
+        cout << "Using default: " << R << endl;
+    }
+    cout << "Enter inductor value (henries) [default " << L << "]: ";
+	getline(cin, inputLine); // input line
+    if (inputLine.empty() || !(istringstream(inputLine) >> L)) {
+        L = 0.05;
+        cout << "Using default: " << L << endl;
+    }
+    cout << "Enter capacitor value (farads) [default " << C << "]: ";
+	getline(cin, inputLine); // input line
+    if (inputLine.empty() || !(istringstream(inputLine) >> C)) {
+        C = 0.00007;
+        cout << "Using default: " << C << endl;
+    }
+    cout << "Enter frequency (Hz) [default " << freq << "]: ";
+	getline(cin, inputLine); // input line
+    if (inputLine.empty() || !(istringstream(inputLine) >> freq)) {
+        freq = 50.0;
+        cout << "Using default: " << freq << endl;
+    }
+    cout << "Enter peak voltage (V) [default " << Vpeak << "]: ";
+	getline(cin, inputLine); // input line
+    if (inputLine.empty() || !(istringstream(inputLine) >> Vpeak)) {
+        Vpeak = 10.0;
+        cout << "Using default: " << Vpeak << endl;
+    }
+    cout << "Enter simulation time (seconds) [default " << simTime << "]: ";
+	getline(cin, inputLine); // input line
+    if (inputLine.empty() || !(istringstream(inputLine) >> simTime)) {
+        simTime = 0.1;
+        cout << "Using default: " << simTime << endl;
+    }
+
+	// Display chosen parameters
+    cout << "\nStarting simulation with:" << endl;
+    cout << "R = " << R << " ohms, L = " << L << " H, C = " << C << " F" << endl;
+    cout << "Frequency = " << freq << " Hz, Vpeak = " << Vpeak << " V" << endl;
+    cout << "Simulation time = " << simTime << " seconds" << endl;
+
+	// Create the circuit instance
+    AnalogCircuit* circuit = new AnalogCircuit("RLC.dat", R, L, C, freq, Vpeak, simTime);
+    if (!threadedMode) circuit->SetMessagePump(PumpMessages); // Worker must not pump UI messages
+
+    // Reset the drawing history for the new run
+    waveformHistory.Clear();
+
+    currentCircuit = circuit;
+    circuit->run();
+    globalSimulationRunning = true;
+    globalSimulationComplete = false;
+
+    if (threadedMode) {
+        circuit->SetVerbose(false); // Keep cout free for the display thread
+        sampleRing.clear();
+        workerStop = false;
+        workerDone = false;
+        worker = thread(simulationWorker, circuit);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Draw background grid
+void drawGrid() {
+    // Light gray grid (darker for black background, but commented out in display)
+    glColor3f(0.3f, 0.3f, 0.3f);
+    glBegin(GL_LINES);
+
+    // Vertical lines
+    for (int x = 50; x < windowWidth; x += 50) {
+        glVertex2f((float)x, 0.0f);
+        glVertex2f((float)x, (float)windowHeight);
+    }
+
+    // Horizontal lines  
+    for (int y = 50; y < windowHeight; y += 50) {
+        glVertex2f(0.0f, (float)y);
+        glVertex2f((float)windowWidth, (float)y);
+    }
+
+    glEnd();
+}
+
+//------------------------------------------------------------------------------
+void drawAxes() {
+    // WHITE axes to show on black background
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glLineWidth(2.0f);
+    glBegin(GL_LINES);
+
+    // Y-axis
+    glVertex2f(50.0f, 0.0f);
+    glVertex2f(50.0f, (float)windowHeight);
+
+    // X-axis
+    glVertex2f(0.0f, (float)windowHeight / 2.0f);
+    glVertex2f((float)windowWidth, (float)windowHeight / 2.0f);
+
+    glEnd();
+    glLineWidth(1.0f);
+
+    // Labels 
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glRasterPos2f(30.0f, (float)windowHeight / 2.0f - 15.0f);
+    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"0V");
+
+    glRasterPos2f(30.0f, (float)windowHeight - 30.0f);
+    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"+V");
+
+    glRasterPos2f(30.0f, 30.0f);
+    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"-V");
+
+    glRasterPos2f((float)windowWidth - 50.0f, (float)windowHeight / 2.0f - 15.0f);
+    glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const unsigned char*)"Time");
+}
+
+//------------------------------------------------------------------------------
+// Draw voltage history
+void drawVoltageHistory() {
+    // This is now handled by real-time display
+}
+
+//------------------------------------------------------------------------------
+// Check if simulation is running
+bool isSimulationRunning() {
+    if (threadedMode) return globalSimulationRunning; // Circuit state belongs to the worker
+    return globalSimulationRunning && currentCircuit && currentCircuit->simulationRunning;
+}
+//------------------------------------------------------------------------------
+// Check if simulation is complete
+bool isSimulationComplete() {
+    if (threadedMode) return globalSimulationComplete;
+    return globalSimulationComplete || (currentCircuit && currentCircuit->simulationComplete);
+}
+
+//------------------------------------------------------------------------------
+// Append one sample to the drawing history
+static void appendHistory(const Sample& s) {
+    uint64_t start = Instrumentation::Now();
+    double row[4] = { s.vR, s.vC, s.vL, s.vin };
+    waveformHistory.Append(s.time, row);
+    currentCircuit->stats.AddPhase(PHASE_HISTORY, start);
+}
+
+//------------------------------------------------------------------------------
+// Move everything the worker has published into the history (display thread)
+void drainSamples() {
+    if (!threadedMode || !currentCircuit) return;
+
+    Sample s;
+    while (sampleRing.pop(s)) appendHistory(s);
+
+    // Worker finished and its last sample has been consumed
+    if (workerDone && sampleRing.empty() && !globalSimulationComplete) {
+        worker.join();
+        globalSimulationRunning = false;
+        globalSimulationComplete = true;
+        reportCompletion();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Stop the worker (if any) and release the circuit
+void stopSimulation() {
+    if (worker.joinable()) {
+        workerStop = true;
+        worker.join();
+    }
+    delete currentCircuit;
+    currentCircuit = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Perform one simulation step
+void simulationStep() {
+    if (!currentCircuit) return;
+
+    // Worker thread does the stepping, just ask for the next frame
+    if (threadedMode) {
+        glutPostRedisplay();
+        return;
+    }
+
+    if (currentCircuit->runStep()) {
+        // Store for history
+        appendHistory(currentCircuit->lastSample);
+
+        // Simulation continues
+        glutPostRedisplay();
+    }
+    else {
+        // Simulation complete
+        globalSimulationRunning = false;
+        globalSimulationComplete = true;
+        reportCompletion();
+        glutPostRedisplay(); // Final update
+    }
+}
+
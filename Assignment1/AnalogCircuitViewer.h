@@ -0,0 +1,37 @@
+#ifndef _ANALOGCIRCUITVIEWERH
+#define _ANALOGCIRCUITVIEWERH
+
+// GLUT viewer glue: a thin client that steps the simulation core and keeps
+// the drawing history. Nothing in here is needed for headless runs.
+
+#include <cstddef>
+#include <string>
+#include "WaveformHistory.h" // Bounded drawing history
+
+class AnalogCircuit;
+
+// Global variables for graphics
+extern int windowWidth; // Width of the OpenGL window
+extern int windowHeight; // Height of the OpenGL window
+extern double scalingFactor; //Scaling factor for drawing components
+
+// Drawing history: channels vR, vC, vL, then the input voltage
+extern WaveformHistory waveformHistory;
+
+extern AnalogCircuit* currentCircuit; // Circuit driven by the viewer
+
+void start(); // Start the simulation
+void drawGrid(); // Draw the background grid
+void drawAxes(); // Draw X and Y axes
+void drawVoltageHistory(); // Draw voltage vs time plot
+void simulationStep(); // Perform one simulation step
+void setThreadedMode(bool on); // Run the simulation on a worker thread (call before start)
+void setHistoryPolicy(RetentionPolicy policy, size_t samples, bool compact); // Retention (call before start)
+void setStatsFile(const std::string& filename); // JSON statistics at the end of the run, "-" = cout
+void printStats(); // Print the live run counters
+void drainSamples(); // Pull samples published by the worker into the history
+void stopSimulation(); // Stop the worker and delete the current circuit
+bool isSimulationRunning(); // Check if simulation is running
+bool isSimulationComplete(); // Check if simulation is complete
+
+#endif // _ANALOGCIRCUITVIEWERH
@@ -0,0 +1,384 @@
+// BatchRunner.cpp - Job file batches with a content-addressed result cache
+
+#include "BatchRunner.h"
+#include "TraceArchive.h" // Cache entry traces
+#include "TraceWriter.h" // Job data files
+#include "ThreadPool.h" // Work-stealing pool
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+static const char* solverNames[] = { "direct", "heuristic", "newton", "exact" };
+
+//------------------------------------------------------------------------------
+BatchRunner::BatchRunner(const string& cacheDirectory, uint64_t cacheBytes, double band)
+    : cacheDir(cacheDirectory), cacheLimit(cacheBytes), settleBand(band), simulated(0), evicted(0), runSeconds(0.0) {
+}
+
+//------------------------------------------------------------------------------
+// FIPS 180-4 SHA-256
+string BatchRunner::Sha256(const string& text) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    // Message, a 1 bit, zeros to 56 mod 64 bytes, then the bit length big-endian
+    string message = text;
+    message += '\x80';
+    while (message.size() % 64 != 56) message += '\0';
+    uint64_t bits = uint64_t(text.size()) * 8;
+    for (int i = 7; i >= 0; --i) message += static_cast<char>(bits >> (8 * i));
+
+    for (size_t block = 0; block < message.size(); block += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(&message[block + 4 * i]);
+            w[i] = uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+
+    char hex[65];
+    for (int i = 0; i < 8; ++i) snprintf(hex + 8 * i, 9, "%08x", h[i]);
+    return string(hex, 64);
+}
+
+//------------------------------------------------------------------------------
+bool BatchRunner::Load(const string& filename) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open job file " << filename << endl;
+        return false;
+    }
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream fields(line);
+        BatchJob job{ 20.0, 0.05, 0.00007, 50.0, 10.0, 0.1, SOLVER_DIRECT, 0.0, "", "", "", SweepResult{}, 0.0, false, false };
+        bool any = false;
+        for (string field; fields >> field; any = true) {
+            size_t eq = field.find('=');
+            string name = field.substr(0, eq), value = eq == string::npos ? string() : field.substr(eq + 1);
+            double* number = name == "R" ? &job.R : name == "L" ? &job.L : name == "C" ? &job.C
+                : name == "f" ? &job.freq : name == "V" ? &job.Vpeak : name == "t" ? &job.simTime
+                : name == "step" ? &job.step : nullptr;
+            bool ok = eq != string::npos;
+            if (ok && number) ok = bool(istringstream(value) >> *number);
+            else if (ok && name == "out") job.output = value;
+            else if (ok && name == "solver") {
+                auto found = find(begin(solverNames), end(solverNames), value);
+                ok = found != end(solverNames);
+                job.solver = static_cast<SolverMode>(found - begin(solverNames));
+            }
+            else ok = false;
+            if (!ok) {
+                cerr << "Error: " << filename << " line " << lineNumber << ": bad field '" << field << "'" << endl;
+                return false;
+            }
+        }
+        if (!any) continue;
+        if (job.simTime <= 0.0 || job.step < 0.0) {
+            cerr << "Error: " << filename << " line " << lineNumber << ": run length and step must be positive" << endl;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// The step and tolerance come from a circuit built with the job's values, so
+// a change to the constructor's defaults changes the keys too. %.17g prints
+// every double so that it reads back exactly.
+void BatchRunner::Normalise(BatchJob& job) const {
+    AnalogCircuit probe("", job.R, job.L, job.C, job.freq, job.Vpeak, job.simTime);
+    if (job.step > 0.0) probe.SetTimeStep(job.step);
+
+    ostringstream key;
+    auto put = [&key](const char* name, double v) {
+        char text[40];
+        snprintf(text, sizeof(text), "%.17g", v == 0.0 ? 0.0 : v); // -0 is 0
+        key << name << '=' << text << '\n';
+    };
+    key << "version=" << batchSolverVersion << '\n' << "archive=" << archiveVersion << '\n';
+    put("R", job.R);
+    put("L", job.L);
+    put("C", job.C);
+    put("freq", job.freq);
+    put("Vpeak", job.Vpeak);
+    put("simTime", job.simTime);
+    put("T", probe.GetTimeStep());
+    put("tolerance", probe.GetTolerance());
+    key << "solver=" << solverNames[job.solver] << '\n';
+    job.key = key.str();
+    job.hash = Sha256(job.key);
+}
+
+//------------------------------------------------------------------------------
+string BatchRunner::EntryPath(const string& hash, const char* extension) const {
+    return (filesystem::path(cacheDir) / (hash + extension)).string();
+}
+
+//------------------------------------------------------------------------------
+// An entry counts only with both files and a key that matches in full
+bool BatchRunner::Lookup(BatchJob& job) const {
+    string meta = EntryPath(job.hash, ".txt");
+    ifstream in(meta);
+    if (!in.is_open()) return false;
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    if (text.compare(0, job.key.size(), job.key) != 0) return false;
+
+    istringstream rest(text.substr(job.key.size()));
+    string word;
+    SweepResult r;
+    double seconds;
+    if (!(rest >> word >> r.peakVC >> r.peakI >> r.settleTime >> r.steps >> seconds) || word != "result") return false;
+    error_code failed;
+    if (!filesystem::exists(EntryPath(job.hash, ".rlcz"), failed)) return false;
+
+    filesystem::last_write_time(meta, filesystem::file_time_type::clock::now(), failed); // Most recently used
+    job.result = r;
+    job.seconds = seconds;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Trace first, then the key file: an entry without its key file is never
+// served. Both are written under unique names and renamed into place.
+bool BatchRunner::Simulate(BatchJob& job) const {
+    string unique = "." + to_string(chrono::steady_clock::now().time_since_epoch().count());
+    string trace = EntryPath(job.hash, (unique + ".rlcz").c_str());
+    auto begin = chrono::steady_clock::now();
+    bool written;
+    {
+        AnalogCircuit circuit(trace, job.R, job.L, job.C, job.freq, job.Vpeak, job.simTime);
+        circuit.SetVerbose(false);
+        circuit.SetSolver(job.solver);
+        circuit.SetArchiveBits(archiveExactBits);
+        if (job.step > 0.0) circuit.SetTimeStep(job.step);
+        job.result = ParameterSweep::Simulate(circuit, settleBand);
+        written = circuit.CloseOutput(); // Writes the trace index
+    }
+    job.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    error_code failed;
+    if (!written) {
+        // A short trace must never become a cache entry
+        filesystem::remove(trace, failed);
+        return false;
+    }
+    filesystem::rename(trace, EntryPath(job.hash, ".rlcz"), failed);
+    string meta = EntryPath(job.hash, (unique + ".txt").c_str());
+    {
+        ofstream out(meta);
+        char text[200];
+        snprintf(text, sizeof(text), "result %.17g %.17g %.17g %d %.17g\n", job.result.peakVC, job.result.peakI,
+            job.result.settleTime, job.result.steps, job.seconds);
+        out << job.key << text;
+        if (!out) failed = make_error_code(errc::io_error);
+    }
+    if (!failed) filesystem::rename(meta, EntryPath(job.hash, ".txt"), failed);
+    if (failed) {
+        cerr << "Error: Could not add " << job.hash << " to the cache in " << cacheDir << endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Decoded one chunk at a time into the layout the name asks for
+bool BatchRunner::Materialise(const BatchJob& job) const {
+    if (job.output.empty()) return true;
+    TraceArchiveReader reader;
+    if (!reader.Open(EntryPath(job.hash, ".rlcz"))) return false;
+    TraceWriter writer;
+    if (!writer.Open(job.output)) {
+        cerr << "Error: Could not open output file " << job.output << endl;
+        return false;
+    }
+    writer.WriteHeader(reader.Names());
+    vector<double> values;
+    size_t columns = reader.Columns();
+    for (size_t k = 0; k < reader.Chunks(); ++k) {
+        if (!reader.ReadChunk(k, values)) {
+            cerr << "Error: cache entry " << job.hash << " is damaged" << endl;
+            return false;
+        }
+        for (size_t row = 0; row + columns <= values.size(); row += columns)
+            writer.WriteRow(&values[row], static_cast<int>(columns));
+    }
+    if (!writer.Close()) {
+        cerr << "Error: Could not write output file " << job.output << endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Files are grouped by the hash before the first '.'; a group's last use is
+// the modification time of its key file
+void BatchRunner::Evict() {
+    evicted = 0;
+    if (cacheLimit == 0) return;
+    struct Entry {
+        filesystem::file_time_type used;
+        uint64_t bytes;
+        vector<filesystem::path> files;
+    };
+    map<string, Entry> entries;
+    uint64_t total = 0;
+    error_code failed;
+    for (const auto& file : filesystem::directory_iterator(cacheDir, failed)) {
+        if (!file.is_regular_file(failed)) continue;
+        string name = file.path().filename().string();
+        Entry& entry = entries[name.substr(0, name.find('.'))];
+        uint64_t bytes = file.file_size(failed);
+        auto time = file.last_write_time(failed);
+        if (entry.files.empty() || file.path().extension() == ".txt") entry.used = time;
+        entry.bytes += bytes;
+        entry.files.push_back(file.path());
+        total += bytes;
+    }
+
+    vector<Entry*> order;
+    for (auto& e : entries) order.push_back(&e.second);
+    sort(order.begin(), order.end(), [](const Entry* a, const Entry* b) { return a->used < b->used; });
+    for (Entry* e : order) {
+        if (total <= cacheLimit) break;
+        for (const auto& file : e->files) filesystem::remove(file, failed);
+        total -= e->bytes;
+        evicted++;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BatchRunner::Run(unsigned threads) {
+    auto begin = chrono::steady_clock::now();
+    error_code failed;
+    filesystem::create_directories(cacheDir, failed);
+    if (failed) {
+        cerr << "Error: Could not create cache directory " << cacheDir << endl;
+        return false;
+    }
+
+    // One lookup per distinct key; repeats within the batch share its result
+    map<string, size_t> firstWithKey;
+    vector<size_t> misses;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        BatchJob& job = jobs[i];
+        Normalise(job);
+        job.duplicate = !firstWithKey.emplace(job.hash, i).second;
+        job.cached = false;
+        if (job.duplicate) continue;
+        job.cached = Lookup(job);
+        if (!job.cached) misses.push_back(i);
+    }
+
+    ThreadPool pool(threads);
+    atomic<bool> ok(true);
+    for (size_t i : misses) pool.submit([this, i, &ok] { if (!Simulate(jobs[i])) ok = false; });
+    pool.wait();
+    simulated = misses.size();
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        size_t first = firstWithKey[jobs[i].hash];
+        if (first == i) continue;
+        jobs[i].result = jobs[first].result;
+        jobs[i].seconds = jobs[first].seconds;
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i) pool.submit([this, i, &ok] { if (!Materialise(jobs[i])) ok = false; });
+    pool.wait();
+
+    Evict();
+    runSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Same fixed-width layout as a sweep summary, plus where the result came from
+void BatchRunner::WriteSummary(const string& filename) const {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open output file " << filename << endl;
+        exit(1);
+    }
+
+    out << setw(8) << "Index" << setw(12) << "R" << setw(12) << "L" << setw(12) << "C"
+        << setw(12) << "Freq" << setw(12) << "Vpeak" << setw(12) << "Time" << setw(12) << "PeakVC"
+        << setw(12) << "PeakI" << setw(12) << "Settle" << setw(8) << "Cached" << setw(8) << "Repeat" << setw(18) << "Key" << '\n';
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const BatchJob& j = jobs[i];
+        out << setw(8) << i << setw(12) << j.R << setw(12) << j.L << setw(12) << j.C
+            << setw(12) << j.freq << setw(12) << j.Vpeak << setw(12) << j.simTime << setw(12) << j.result.peakVC
+            << setw(12) << j.result.peakI << setw(12) << j.result.settleTime << setw(8) << (j.cached ? 1 : 0)
+            << setw(8) << (j.duplicate ? 1 : 0) << setw(18) << j.hash.substr(0, 16) << '\n';
+    }
+}
+
+//------------------------------------------------------------------------------
+// The hit rate is over distinct keys, the lookups actually made; repeats
+// within the batch would be shared without any cache, so they count apart.
+// Time saved is what the entries served from disk originally took to simulate
+void BatchRunner::Report(ostream& out) const {
+    size_t hits = 0, repeats = 0;
+    double saved = 0.0, spent = 0.0;
+    for (const auto& j : jobs) {
+        if (j.duplicate) repeats++;
+        else if (j.cached) {
+            hits++;
+            saved += j.seconds;
+        }
+        else spent += j.seconds;
+    }
+    size_t distinct = jobs.size() - repeats;
+    double rate = distinct == 0 ? 0.0 : 100.0 * hits / distinct;
+    out << jobs.size() << " jobs, " << distinct << " distinct: " << hits << " from the cache (" << rate
+        << "% hit rate), " << simulated << " simulated in " << spent << " s of run time";
+    if (repeats) out << ", " << repeats << " repeated within the batch";
+    out << endl;
+    out << "Time saved by the cache: " << saved << " s of simulation; batch took " << runSeconds << " s" << endl;
+    if (evicted) out << evicted << " least recently used cache entries evicted to stay within "
+        << cacheLimit / 1048576.0 << " MiB" << endl;
+}
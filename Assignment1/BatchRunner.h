@@ -0,0 +1,73 @@
+#ifndef _BATCHRUNNERH
+#define _BATCHRUNNERH
+
+#include "AnalogCircuit.h" // SolverMode
+#include "ParameterSweep.h" // SweepResult
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Tag hashed into every cache key. Bump it with any change that alters the
+// numbers a circuit produces (solver, companion models, source), so results
+// of an older build are never served.
+const char* const batchSolverVersion = "anasim-solver-1";
+
+// One line of a job file
+struct BatchJob {
+    double R, L, C, freq, Vpeak, simTime; // Circuit and run length
+    SolverMode solver;
+    double step; // Fixed time step, 0 = the circuit's default
+    std::string output; // Data file to produce (.dat or .rlcz), empty = summary only
+    std::string key; // Normalised configuration, one "name=value" per line
+    std::string hash; // SHA-256 of key, hex
+    SweepResult result; // Peaks and settling time
+    double seconds; // Wall time of the run that produced the result
+    bool cached; // Served from an entry already on disk
+    bool duplicate; // Repeats an earlier job of this batch and shares its result
+};
+
+// Batch runs with a content-addressed result cache. Each job is normalised
+// (defaults filled in, the step and solver tolerance taken from a circuit
+// built with its values, numbers printed round-trip exactly) and hashed with
+// the solver version tag. A cache entry is the full trace as an exact .rlcz
+// archive plus a small text file with the key and the summary; every job's
+// data file is produced from its entry, so a hit and a miss give identical
+// files. Only distinct keys not in the cache are simulated, on the thread
+// pool. The cache is bounded by size: each hit refreshes the entry's
+// modification time, and the least recently used entries are deleted at the
+// end of a batch until the total fits.
+//
+// Job file: one job per line, "name=value" fields separated by spaces, any
+// field left out takes the viewer default; # starts a comment.
+//   R=20 L=0.05 C=7e-5 f=50 V=10 t=0.1 solver=direct step=1e-4 out=Job1.dat
+class BatchRunner {
+    std::vector<BatchJob> jobs;
+    std::string cacheDir; // Entry directory, created on demand
+    uint64_t cacheLimit; // Bytes kept after a batch, 0 = unbounded
+    double settleBand; // Settling band as a fraction of peak |vC|
+    size_t simulated; // Distinct keys simulated in the last Run()
+    size_t evicted; // Entries deleted by the last Run()
+    double runSeconds; // Wall time of the last Run()
+
+    void Normalise(BatchJob& job) const; // Fill key and hash
+    std::string EntryPath(const std::string& hash, const char* extension) const;
+    bool Lookup(BatchJob& job) const; // Result from the cache, false on a miss
+    bool Simulate(BatchJob& job) const; // Run and add to the cache
+    bool Materialise(const BatchJob& job) const; // Write the job's data file from its entry
+    void Evict(); // Enforce cacheLimit, oldest access first
+
+public:
+    BatchRunner(const std::string& cacheDirectory, uint64_t cacheBytes, double band = 0.02);
+
+    bool Load(const std::string& filename); // Read a job file, false with a message on bad input
+    bool Run(unsigned threads); // Serve or simulate every job, then write the data files
+    void WriteSummary(const std::string& filename) const; // One row per job, like a sweep summary
+    void Report(std::ostream& out) const; // Hit rate and time saved by the cache, repeats counted apart
+    size_t Count() const { return jobs.size(); }
+
+    static std::string Sha256(const std::string& text); // Hex digest
+};
+
+#endif // _BATCHRUNNERH
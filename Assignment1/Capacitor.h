@@ -2,7 +2,7 @@
 #include <string>
 #include "Component.h"
 
-class Capacitor : public Component {
+class Capacitor final : public Component {
 	double capacitance; //Capacitance in farads
 	double voltage; // Current voltage across capacitor
 public:
@@ -14,6 +14,11 @@ public:
     virtual double GetVoltage(double I, double T) override {
         // Return current voltage state
         return voltage;
+    }
+    //Backward Euler companion: V = (T / C) * I + voltage
+    virtual void GetCompanion(double T, double& Req, double& Veq) override {
+        Req = T / capacitance;
+        Veq = voltage;
     }
 	//Update capacitor state based on current and timestep
     virtual void Update() override {
@@ -21,6 +26,30 @@ public:
         // This will be called from AnalogCircuit after current is found
     }
 
+    //AC impedance  Z = 1 / (j omega C)
+    virtual std::complex<double> GetImpedance(double omega) const override {
+        return std::complex<double>(0.0, -1.0 / (omega * capacitance));
+    }
+
+    //Advance state after an MNA step
+    virtual void Commit(double I, double T) override {
+        UpdateVoltage(I, T);
+    }
+
+    //Checkpoint state
+    virtual int StateSize() const override { return 1; }
+    virtual void SaveState(std::vector<double>& out) const override { out.push_back(voltage); }
+    virtual void LoadState(const double* in) override { voltage = in[0]; }
+
+    //Set the initial voltage (IC=)
+    void SetVoltage(double v) {
+        voltage = v;
+    }
+    //Stored voltage (the state carried between steps)
+    double GetStoredVoltage() const {
+        return voltage;
+    }
+
     //Update voltage based on current 
     void UpdateVoltage(double I, double T) {
         // EXACTLY as specified in requirements: voltage[1] = voltage[0] + current * timestep / capacitance
@@ -1,7 +1,11 @@
 #ifndef _COMPONENTH
 #define _COMPONENTH
 
+#include <complex>
 #include <string>
+#include <vector>
+
+class MnaSystem; // Nodal analysis matrix, see MnaSystem.h
 
 class Component {
 protected:
@@ -11,6 +15,12 @@ protected:
     float Blue = 0.0f;
 	std::string name; //Name of the component
 
+    //Connection for nodal analysis (node 0 is ground)
+    int nodeA = 0; //Positive terminal
+    int nodeB = 0; //Negative terminal
+    int branch = -1; //Extra MNA unknown for elements that need one
+    double branchCurrent = 0.0; //Current from A to B at the last accepted step
+
 public:
 	//Virtual destructor for proper cleanup
     virtual ~Component() {}
@@ -20,7 +30,49 @@ public:
     virtual std::string GetName() const = 0; //Return component name
     virtual void        Update() = 0; //Update component state
 	virtual double      GetVoltage(double current, double timestep) = 0; //Return voltage across  component
+    virtual void        GetCompanion(double timestep, double& Req, double& Veq) = 0; //Linearised model for one step: V = Req * I + Veq
     virtual void        Display() = 0; //Render the component
+
+    //Nodal analysis: the default stamps are the Norton form of GetCompanion,
+    //G = 1/Req between A and B plus a current source of Veq/Req
+    void         SetNodes(int a, int b) { nodeA = a; nodeB = b; } //Attach to nodes
+    int          GetNodeA() const { return nodeA; }
+    int          GetNodeB() const { return nodeB; }
+    void         SetBranch(int index) { branch = index; } //Assign extra unknown
+    double       GetBranchCurrent() const { return branchCurrent; } //Current at the last step
+    virtual int  BranchCount() const { return 0; } //Extra unknowns this element needs
+    virtual void StampMatrix(MnaSystem& mna, double timestep); //Constant part, stamped when T changes
+    virtual void StampRhs(MnaSystem& mna, double time, double timestep); //History/source part, every step
+    virtual void AcceptSolution(const MnaSystem& mna, double timestep); //Read the solution, then Commit
+    virtual void Commit(double /*current*/, double /*timestep*/) {} //Advance internal state with the step's current
+
+    //Newton-Raphson support. The series solver needs V(I) and dV/dI at a trial
+    //current; the default is the linear companion model, which is exact for R, L, C.
+    virtual bool IsNonlinear() const { return false; }
+    virtual void GetVoltageAndSlope(double current, double timestep, double& V, double& dVdI) {
+        double Req, Veq;
+        GetCompanion(timestep, Req, Veq);
+        V = Req * current + Veq;
+        dVdI = Req;
+    }
+    //Newton step limiting: pull a proposed loop current back toward the previous
+    //one if it would swing this element's voltage too far in one iteration
+    virtual double LimitCurrent(double /*previous*/, double proposed) { return proposed; }
+    //Nodal analysis Newton: read the trial solution, move the element's operating
+    //point (with any step limiting) and return true once it has settled
+    virtual bool NewtonUpdate(const MnaSystem& /*mna*/, double /*timestep*/) { return true; }
+    //Relative change of the element's slope since it was last stamped into the matrix
+    virtual double JacobianDrift() const { return 0.0; }
+
+    //AC analysis: small-signal impedance at angular frequency omega, linearised
+    //at the last accepted operating point. Ideal sources contribute nothing.
+    virtual std::complex<double> GetImpedance(double /*omega*/) const { return 0.0; }
+
+    //Checkpoint/restart: the values that carry the element from one step to
+    //the next, appended to out, and read back in the same order
+    virtual int  StateSize() const { return 0; }
+    virtual void SaveState(std::vector<double>& /*out*/) const {}
+    virtual void LoadState(const double* /*in*/) {}
 };
 
 #endif // _COMPONENTH
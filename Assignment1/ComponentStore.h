@@ -0,0 +1,104 @@
+#ifndef _COMPONENTSTOREH
+#define _COMPONENTSTOREH
+
+// By-value component containers that avoid a virtual call per element in the
+// hot loops. The concrete component classes are final, so a call through a
+// Resistor& (rather than a Component*) is bound at compile time and inlined.
+// Both containers hand out Component* views, so code written against the
+// virtual Component API keeps working on the same objects.
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Component.h"
+
+// Circuit whose composition is fixed at compile time: one element of each
+// listed type, in order. The series-loop sums below unroll into straight-line
+// code with no indirection.
+template <class... Parts>
+class StaticCircuit {
+    std::tuple<Parts...> parts; // The elements, stored inline
+
+    template <class F, size_t... K>
+    void Apply(F&& f, std::index_sequence<K...>) { (f(std::get<K>(parts)), ...); }
+
+public:
+    explicit StaticCircuit(Parts... p) : parts(std::move(p)...) {}
+
+    static constexpr size_t Count() { return sizeof...(Parts); }
+    template <size_t K> auto& Get() { return std::get<K>(parts); }
+    template <size_t K> const auto& Get() const { return std::get<K>(parts); }
+
+    // Call f on every element, in order, with its concrete type
+    template <class F>
+    void ForEach(F&& f) { Apply(f, std::index_sequence_for<Parts...>{}); }
+
+    // Series loop: sum of the companion models  V = sumR * I + sumV
+    void Companion(double T, double& sumR, double& sumV) {
+        sumR = 0.0;
+        sumV = 0.0;
+        ForEach([&](auto& c) {
+            double Req, Veq;
+            c.GetCompanion(T, Req, Veq);
+            sumR += Req;
+            sumV += Veq;
+        });
+    }
+
+    // Series loop: sum of GetVoltage at a trial current
+    double Voltage(double I, double T) {
+        double sumV = 0.0;
+        ForEach([&](auto& c) { sumV += c.GetVoltage(I, T); });
+        return sumV;
+    }
+
+    void Commit(double I, double T) { ForEach([&](auto& c) { c.Commit(I, T); }); }
+
+    // Virtual view of the elements, appended in order
+    void Pointers(std::vector<Component*>& out) { ForEach([&](auto& c) { out.push_back(&c); }); }
+};
+
+// Elements whose number is only known at run time (a netlist), stored by
+// value in one contiguous array per type. ForEach visits type by type, so
+// each inner loop calls one concrete class. Add() may reallocate an array:
+// take Pointers() only after the last Add().
+template <class... Types>
+class ComponentStore {
+    std::tuple<std::vector<Types>...> arrays; // One array per type
+
+public:
+    template <class T, class... Args>
+    T& Add(Args&&... args) {
+        auto& array = std::get<std::vector<T>>(arrays);
+        array.emplace_back(std::forward<Args>(args)...);
+        return array.back();
+    }
+
+    template <class T> std::vector<T>& Of() { return std::get<std::vector<T>>(arrays); }
+
+    size_t Size() const {
+        size_t n = 0;
+        std::apply([&](const auto&... array) { ((n += array.size()), ...); }, arrays);
+        return n;
+    }
+
+    void Clear() { std::apply([](auto&... array) { (array.clear(), ...); }, arrays); }
+
+    // Call f on every element with its concrete type, one type at a time
+    template <class F>
+    void ForEach(F&& f) {
+        std::apply([&](auto&... array) { (ForAll(array, f), ...); }, arrays);
+    }
+
+    // Virtual view of the elements, appended type by type
+    void Pointers(std::vector<Component*>& out) { ForEach([&](auto& c) { out.push_back(&c); }); }
+
+private:
+    template <class Array, class F>
+    static void ForAll(Array& array, F& f) {
+        for (auto& c : array) f(c);
+    }
+};
+
+#endif // _COMPONENTSTOREH
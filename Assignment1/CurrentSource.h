@@ -0,0 +1,51 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include "Component.h"
+#include "MnaSystem.h"
+
+
+// Independent current source  I(t) = dc + amplitude * sin(2 pi freq t).
+// Positive current flows from node A through the source to node B (SPICE convention).
+class CurrentSource final : public Component {
+	double dc; //DC offset in amps
+	double amplitude; //Sine amplitude in amps
+	double freq; //Sine frequency in hertz
+public:
+    CurrentSource(double offset, double amp, double frequency, float R, float G, float B, std::string n)
+        : dc(offset), amplitude(amp), freq(frequency) {
+        Red = R; Green = G; Blue = B; name = n;
+    }
+
+	//Source current at time t
+    double GetValue(double t) const {
+        return dc + amplitude * sin(2.0 * 3.14159265358979323846 * freq * t);
+    }
+
+	//Terminal voltage is set by the rest of the circuit, not the source
+    virtual double GetVoltage(double /*I*/, double /*T*/) override {
+        return 0.0;
+    }
+    //No series companion form exists for an ideal current source
+    virtual void GetCompanion(double /*T*/, double& Req, double& Veq) override {
+        Req = 0.0;
+        Veq = 0.0;
+    }
+
+    //Nodal analysis: only a right-hand side contribution
+    virtual void StampMatrix(MnaSystem& /*mna*/, double /*T*/) override {}
+    virtual void StampRhs(MnaSystem& mna, double time, double /*T*/) override {
+        branchCurrent = GetValue(time);
+        mna.AddCurrent(nodeA, nodeB, branchCurrent);
+    }
+    virtual void AcceptSolution(const MnaSystem& /*mna*/, double /*T*/) override {}
+
+    //update component state
+    virtual void Update() override {}
+
+	//Render the source visually
+    virtual void Display() override;
+
+	//Return the component name
+    virtual std::string GetName() const override { return name; }
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include "Component.h"
+#include "MnaSystem.h"
+
+
+// Junction diode  I = Is * (exp(V / (n Vt)) - 1) + Gmin * V, anode = node A.
+// Gmin keeps the reverse-biased diode from leaving a node floating and keeps
+// V(I) defined for every current.
+class Diode final : public Component {
+	double Is; //Saturation current in amps
+	double nVt; //Emission coefficient times thermal voltage
+	double gmin = 1e-12; //Parallel conductance in siemens
+	double vLast = 0.0; //Junction voltage at the last accepted step
+	double vIter = 0.0; //Nodal analysis Newton operating point
+	double stampedG = 0.0; //Conductance in the factored matrix
+public:
+    Diode(double saturation, double emission, float R, float G, float B, std::string n)
+        : Is(saturation), nVt(emission * 0.025852) {
+        Red = R; Green = G; Blue = B; name = n;
+    }
+
+	//Diode current and conductance at junction voltage v
+    double Current(double v) const { return Is * (exp(v / nVt) - 1.0) + gmin * v; }
+    double Conductance(double v) const { return Is / nVt * exp(v / nVt) + gmin; }
+
+	//Junction voltage that carries current I (Newton from the ideal diode guess)
+    double VoltageFor(double I) const {
+        double v = (I > -Is) ? nVt * log1p(I / Is) : (I + Is) / gmin;
+        for (int k = 0; k < 50; ++k) {
+            double dv = (Current(v) - I) / Conductance(v);
+            v -= dv;
+            if (fabs(dv) <= 1e-12 * (1.0 + fabs(v))) break;
+        }
+        return v;
+    }
+
+	//SPICE junction limiting: large forward steps follow the log of the change
+    double Limit(double vNew, double vOld) const {
+        double vCrit = nVt * log(nVt / (sqrt(2.0) * Is));
+        if (vNew > vCrit && fabs(vNew - vOld) > 2.0 * nVt) {
+            if (vOld > 0.0) {
+                double arg = 1.0 + (vNew - vOld) / nVt;
+                vNew = arg > 0.0 ? vOld + nVt * log(arg) : vCrit;
+            }
+            else vNew = nVt * log(vNew / nVt);
+        }
+        return vNew;
+    }
+
+	//Voltage across the diode for a given current
+    virtual double GetVoltage(double I, double /*T*/) override {
+        return VoltageFor(I);
+    }
+    //Tangent at the last accepted point (used by the direct solver)
+    virtual void GetCompanion(double /*T*/, double& Req, double& Veq) override {
+        Req = 1.0 / Conductance(vLast);
+        Veq = vLast - Req * Current(vLast);
+    }
+    virtual bool IsNonlinear() const override { return true; }
+    virtual void GetVoltageAndSlope(double I, double /*T*/, double& V, double& dVdI) override {
+        V = VoltageFor(I);
+        dVdI = 1.0 / Conductance(V);
+    }
+    //Reverse swings are capped at max(1 V, |V|) per iteration, so the loop
+    //current cannot jump deep past -Is into the Gmin region in one step
+    virtual double LimitCurrent(double previous, double proposed) override {
+        double vOld = VoltageFor(previous), vNew = VoltageFor(proposed);
+        double floor = vOld - fmax(1.0, fabs(vOld));
+        return vNew < floor ? Current(floor) : proposed;
+    }
+    //AC: incremental resistance at the last accepted junction voltage
+    virtual std::complex<double> GetImpedance(double /*omega*/) const override {
+        return 1.0 / Conductance(vLast);
+    }
+    virtual void Commit(double I, double /*T*/) override {
+        vLast = VoltageFor(I);
+        vIter = vLast;
+    }
+
+    //Nodal analysis: Norton model linearised at vIter, I = G * V + Ieq
+    virtual void StampMatrix(MnaSystem& mna, double /*T*/) override {
+        stampedG = Conductance(vIter);
+        mna.AddConductance(nodeA, nodeB, stampedG);
+    }
+    virtual void StampRhs(MnaSystem& mna, double /*time*/, double /*T*/) override {
+        mna.AddCurrent(nodeA, nodeB, Current(vIter) - stampedG * vIter);
+    }
+    virtual bool NewtonUpdate(const MnaSystem& mna, double /*T*/) override {
+        double v = mna.NodeVoltage(nodeA) - mna.NodeVoltage(nodeB);
+        double limited = Limit(v, vIter);
+        bool settled = limited == v && fabs(v - vIter) <= 1e-6 * fabs(v) + 1e-9;
+        vIter = limited;
+        return settled;
+    }
+    virtual double JacobianDrift() const override {
+        double g = Conductance(vIter);
+        return fabs(g - stampedG) / fmax(g, stampedG);
+    }
+    virtual void AcceptSolution(const MnaSystem& /*mna*/, double /*T*/) override {
+        branchCurrent = Current(vIter);
+        vLast = vIter;
+    }
+
+    //Checkpoint state, including the nodal analysis operating point
+    virtual int StateSize() const override { return 3; }
+    virtual void SaveState(std::vector<double>& out) const override {
+        out.push_back(vLast);
+        out.push_back(vIter);
+        out.push_back(stampedG);
+    }
+    virtual void LoadState(const double* in) override {
+        vLast = in[0];
+        vIter = in[1];
+        stampedG = in[2];
+    }
+
+    //update component state
+    virtual void Update() override {}
+
+	//Render the diode visually
+    virtual void Display() override;
+
+	//Return the component name
+    virtual std::string GetName() const override { return name; }
+};
@@ -0,0 +1,208 @@
+// EnsembleStepper.cpp - SIMD lockstep stepping of many series RLC circuits
+
+#define _USE_MATH_DEFINES
+#include "EnsembleStepper.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANASIM_X86 1
+#define ANASIM_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define ANASIM_X86 1
+#define ANASIM_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Kernel arguments: per-circuit constants and state arrays, plus optional
+// peak trackers that are updated in the same pass when Track is true
+struct EnsembleArrays {
+    const double* invReq;
+    const double* TC;
+    const double* LT;
+    double* vC;
+    double* iL;
+    double* peakVC;
+    double* peakI;
+};
+
+//------------------------------------------------------------------------------
+// Portable kernel, selected when the CPU has no AVX2
+template <bool Track>
+static void stepScalar(size_t n, double vin, const EnsembleArrays& a) {
+    for (size_t i = 0; i < n; ++i) {
+        double I = (vin - a.vC[i] + a.LT[i] * a.iL[i]) * a.invReq[i];
+        double c = a.vC[i] + a.TC[i] * I;
+        a.vC[i] = c;
+        a.iL[i] = I;
+        if (Track) {
+            a.peakVC[i] = max(a.peakVC[i], fabs(c));
+            a.peakI[i] = max(a.peakI[i], fabs(I));
+        }
+    }
+}
+
+#ifdef ANASIM_X86
+//------------------------------------------------------------------------------
+// Four circuits per instruction
+template <bool Track>
+ANASIM_TARGET("avx2,fma")
+static void stepAvx2(size_t n, double vin, const EnsembleArrays& a) {
+    const __m256d V = _mm256_set1_pd(vin);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    for (size_t i = 0; i < n; i += 4) {
+        __m256d c = _mm256_loadu_pd(a.vC + i);
+        __m256d l = _mm256_loadu_pd(a.iL + i);
+        __m256d rhs = _mm256_fmadd_pd(_mm256_loadu_pd(a.LT + i), l, _mm256_sub_pd(V, c));
+        __m256d I = _mm256_mul_pd(rhs, _mm256_loadu_pd(a.invReq + i));
+        c = _mm256_fmadd_pd(_mm256_loadu_pd(a.TC + i), I, c);
+        _mm256_storeu_pd(a.vC + i, c);
+        _mm256_storeu_pd(a.iL + i, I);
+        if (Track) {
+            _mm256_storeu_pd(a.peakVC + i, _mm256_max_pd(_mm256_loadu_pd(a.peakVC + i), _mm256_and_pd(c, absMask)));
+            _mm256_storeu_pd(a.peakI + i, _mm256_max_pd(_mm256_loadu_pd(a.peakI + i), _mm256_and_pd(I, absMask)));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Eight circuits per instruction
+template <bool Track>
+ANASIM_TARGET("avx512f")
+static void stepAvx512(size_t n, double vin, const EnsembleArrays& a) {
+    const __m512d V = _mm512_set1_pd(vin);
+    const __m512i absMask = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL);
+    for (size_t i = 0; i < n; i += 8) {
+        __m512d c = _mm512_loadu_pd(a.vC + i);
+        __m512d l = _mm512_loadu_pd(a.iL + i);
+        __m512d rhs = _mm512_fmadd_pd(_mm512_loadu_pd(a.LT + i), l, _mm512_sub_pd(V, c));
+        __m512d I = _mm512_mul_pd(rhs, _mm512_loadu_pd(a.invReq + i));
+        c = _mm512_fmadd_pd(_mm512_loadu_pd(a.TC + i), I, c);
+        _mm512_storeu_pd(a.vC + i, c);
+        _mm512_storeu_pd(a.iL + i, I);
+        if (Track) {
+            _mm512_storeu_pd(a.peakVC + i, _mm512_maskz_max_pd(0xFF, _mm512_loadu_pd(a.peakVC + i), _mm512_castsi512_pd(_mm512_and_epi64(_mm512_castpd_si512(c), absMask))));
+            _mm512_storeu_pd(a.peakI + i, _mm512_maskz_max_pd(0xFF, _mm512_loadu_pd(a.peakI + i), _mm512_castsi512_pd(_mm512_and_epi64(_mm512_castpd_si512(I), absMask))));
+        }
+    }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Arrays are padded to a multiple of 8 so the vector kernels need no tail;
+// padding lanes hold a harmless 1 ohm / 1 H / 1 F circuit
+EnsembleStepper::EnsembleStepper(size_t circuits, double timestep)
+    : count(circuits), padded((circuits + 7) & ~size_t(7)), T(timestep), isa(DetectIsa()) {
+    R.assign(padded, 1.0);
+    L.assign(padded, 1.0);
+    C.assign(padded, 1.0);
+    invReq.resize(padded);
+    TC.resize(padded);
+    LT.resize(padded);
+    for (size_t i = 0; i < padded; ++i) Precompute(i);
+    Reset();
+}
+
+//------------------------------------------------------------------------------
+// Check CPU and OS support for the wider kernels
+EnsembleIsa EnsembleStepper::DetectIsa() {
+#if defined(ANASIM_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return ENSEMBLE_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return ENSEMBLE_AVX2;
+#elif defined(ANASIM_X86)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return ENSEMBLE_SCALAR;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave) return ENSEMBLE_SCALAR;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) return ENSEMBLE_AVX512;
+    if (avx2 && fma && (xcr0 & 0x6) == 0x6) return ENSEMBLE_AVX2;
+#endif
+    return ENSEMBLE_SCALAR;
+}
+
+//------------------------------------------------------------------------------
+const char* EnsembleStepper::IsaName(EnsembleIsa which) {
+    switch (which) {
+    case ENSEMBLE_AVX2: return "avx2";
+    case ENSEMBLE_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+//------------------------------------------------------------------------------
+// Never select more than the hardware supports
+void EnsembleStepper::SetIsa(EnsembleIsa which) {
+    isa = min(which, DetectIsa());
+}
+
+//------------------------------------------------------------------------------
+void EnsembleStepper::Precompute(size_t i) {
+    TC[i] = T / C[i];
+    LT[i] = L[i] / T;
+    invReq[i] = 1.0 / (R[i] + TC[i] + LT[i]);
+}
+
+//------------------------------------------------------------------------------
+void EnsembleStepper::SetCircuit(size_t i, double Rval, double Lval, double Cval) {
+    R[i] = Rval;
+    L[i] = Lval;
+    C[i] = Cval;
+    Precompute(i);
+}
+
+//------------------------------------------------------------------------------
+void EnsembleStepper::Reset() {
+    vC.assign(padded, 0.0);
+    iL.assign(padded, 0.0);
+    peakVC.assign(padded, 0.0);
+    peakI.assign(padded, 0.0);
+}
+
+//------------------------------------------------------------------------------
+// Run the selected kernel, with or without peak tracking
+void EnsembleStepper::Advance(double vin, bool track) {
+    EnsembleArrays a{ invReq.data(), TC.data(), LT.data(), vC.data(), iL.data(), peakVC.data(), peakI.data() };
+#ifdef ANASIM_X86
+    if (isa == ENSEMBLE_AVX512) {
+        if (track) stepAvx512<true>(padded, vin, a); else stepAvx512<false>(padded, vin, a);
+        return;
+    }
+    if (isa == ENSEMBLE_AVX2) {
+        if (track) stepAvx2<true>(padded, vin, a); else stepAvx2<false>(padded, vin, a);
+        return;
+    }
+#endif
+    if (track) stepScalar<true>(padded, vin, a); else stepScalar<false>(padded, vin, a);
+}
+
+//------------------------------------------------------------------------------
+// Advance all circuits by one step
+void EnsembleStepper::Step(double vin) {
+    Advance(vin, false);
+}
+
+//------------------------------------------------------------------------------
+// Same time loop and source as AnalogCircuit::runStep, tracking peaks
+int EnsembleStepper::Run(double freq, double Vpeak, double simTime) {
+    Reset();
+    int steps = 0;
+    for (double t = 0.0; t < simTime; t += T) {
+        double vin = (t < 0.6 * simTime) ? Vpeak * sin(2.0 * M_PI * freq * t) : 0.0;
+        Advance(vin, true);
+        steps++;
+    }
+    return steps;
+}
@@ -0,0 +1,76 @@
+#ifndef _ENSEMBLESTEPPERH
+#define _ENSEMBLESTEPPERH
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Cache-line aligned allocator so vector loads never split a line
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+    AlignedAllocator() {}
+    template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(64))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(64)); }
+    template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<double, AlignedAllocator<double>> AlignedArray; // SoA column
+
+// Instruction set used for the ensemble kernels
+enum EnsembleIsa {
+    ENSEMBLE_SCALAR, // Portable loop
+    ENSEMBLE_AVX2,   // 4 circuits per instruction
+    ENSEMBLE_AVX512  // 8 circuits per instruction
+};
+
+// Advances many series RLC circuits (different R/L/C, same source) in lockstep.
+// State and per-circuit constants live in structure-of-arrays form so each
+// step is a straight vector loop. Uses the same backward Euler companion
+// models as AnalogCircuit's direct solver:
+//   I  = (Vin - vC + (L/T) * iL) / (R + T/C + L/T)
+//   vC = vC + (T/C) * I,  iL = I
+class EnsembleStepper {
+    size_t count; // Number of circuits
+    size_t padded; // count rounded up to a multiple of 8
+    double T; // Time step shared by every circuit
+    EnsembleIsa isa; // Kernel selected at runtime
+
+    AlignedArray R, L, C; // Component values
+    AlignedArray invReq; // 1 / (R + T/C + L/T)
+    AlignedArray TC; // T / C
+    AlignedArray LT; // L / T
+    AlignedArray vC; // Capacitor voltage state
+    AlignedArray iL; // Inductor (loop) current state
+    AlignedArray peakVC; // Largest |vC| seen by Run()
+    AlignedArray peakI; // Largest |I| seen by Run()
+
+    void Precompute(size_t i); // Refresh derived constants for one circuit
+    void Advance(double vin, bool track); // Dispatch to the selected kernel
+
+public:
+    EnsembleStepper(size_t circuits, double timestep);
+
+    static EnsembleIsa DetectIsa(); // Best instruction set this CPU supports
+    static const char* IsaName(EnsembleIsa which); // Printable name
+
+    void SetIsa(EnsembleIsa which); // Override the detected kernel (clamped to support)
+    EnsembleIsa GetIsa() const { return isa; }
+    void SetCircuit(size_t i, double Rval, double Lval, double Cval); // Set component values
+    void Reset(); // Zero all state and peaks
+
+    void Step(double vin); // Advance every circuit by one time step
+    int Run(double freq, double Vpeak, double simTime); // Full transient with AnalogCircuit's source, returns steps
+
+    size_t Size() const { return count; }
+    double Timestep() const { return T; }
+    const double* Current() const { return iL.data(); } // Loop current after the last step
+    const double* CapacitorVoltage() const { return vC.data(); } // vC after the last step
+    double ResistorVoltage(size_t i) const { return R[i] * iL[i]; } // vR after the last step
+    const double* PeakCapacitorVoltage() const { return peakVC.data(); }
+    const double* PeakCurrent() const { return peakI.data(); }
+};
+
+#endif // _ENSEMBLESTEPPERH
@@ -0,0 +1,127 @@
+// EnvelopePyramid.cpp - Level-of-detail min/max summaries for waveform drawing
+
+#include "EnvelopePyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const int levelShift = 2; // Each level groups 4 blocks of the level below
+
+//------------------------------------------------------------------------------
+EnvelopePyramid::EnvelopePyramid() : count(0), maxAbs(0.0) {
+}
+
+//------------------------------------------------------------------------------
+// Fold the new sample into the (possibly partial) last block of every level
+void EnvelopePyramid::Append(double value) {
+    float v = static_cast<float>(value);
+    maxAbs = max(maxAbs, fabs(value));
+
+    for (size_t k = 0;; ++k) {
+        if (k == mins.size()) {
+            // A new top level is needed once the level below has two blocks;
+            // its first block covers everything appended so far
+            if (k > 0 && mins[k - 1].size() < 2) break;
+            float lo = v, hi = v;
+            if (k > 0) {
+                lo = *min_element(mins[k - 1].begin(), mins[k - 1].end());
+                hi = *max_element(maxs[k - 1].begin(), maxs[k - 1].end());
+            }
+            mins.push_back(vector<float>(1, lo));
+            maxs.push_back(vector<float>(1, hi));
+            break;
+        }
+
+        size_t index = count >> (levelShift * (k + 1));
+        if (index == mins[k].size()) {
+            mins[k].push_back(v);
+            maxs[k].push_back(v);
+        }
+        else {
+            mins[k][index] = min(mins[k][index], v);
+            maxs[k][index] = max(maxs[k][index], v);
+        }
+    }
+    count++;
+}
+
+//------------------------------------------------------------------------------
+void EnvelopePyramid::Clear() {
+    mins.clear();
+    maxs.clear();
+    count = 0;
+    maxAbs = 0.0;
+}
+
+//------------------------------------------------------------------------------
+size_t EnvelopePyramid::MemoryBytes() const {
+    size_t bytes = 0;
+    for (size_t k = 0; k < mins.size(); ++k) bytes += (mins[k].capacity() + maxs[k].capacity()) * sizeof(float);
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+// Walk up the levels, consuming partial blocks at both ends from the level
+// below, then finish with the whole blocks in the middle
+template <class Sample>
+static void rangeOf(const vector<vector<float>>& mins, const vector<vector<float>>& maxs, size_t count,
+    const Sample* raw, size_t begin, size_t end, double& lo, double& hi) {
+    lo = HUGE_VAL;
+    hi = -HUGE_VAL;
+    end = min(end, count);
+    if (begin >= end) return;
+
+    // Raw samples up to the first level 1 block boundary
+    size_t block = size_t(1) << levelShift;
+    while (begin < end && (begin & (block - 1)) != 0) {
+        lo = min(lo, double(raw[begin]));
+        hi = max(hi, double(raw[begin]));
+        begin++;
+    }
+    while (begin < end && (end & (block - 1)) != 0) {
+        end--;
+        lo = min(lo, double(raw[end]));
+        hi = max(hi, double(raw[end]));
+    }
+
+    // [begin, end) is now aligned to level 1 blocks
+    size_t b = begin >> levelShift, e = end >> levelShift;
+    for (size_t k = 0; k < mins.size() && b < e; ++k) {
+        const vector<float>& mn = mins[k];
+        const vector<float>& mx = maxs[k];
+        if (k + 1 < mins.size()) {
+            // Blocks that do not fill a whole parent block are handled here
+            while (b < e && (b & (block - 1)) != 0) {
+                lo = min(lo, double(mn[b]));
+                hi = max(hi, double(mx[b]));
+                b++;
+            }
+            while (b < e && (e & (block - 1)) != 0) {
+                e--;
+                lo = min(lo, double(mn[e]));
+                hi = max(hi, double(mx[e]));
+            }
+            b >>= levelShift;
+            e >>= levelShift;
+        }
+        else {
+            // Top level: take what is left
+            for (; b < e; ++b) {
+                lo = min(lo, double(mn[b]));
+                hi = max(hi, double(mx[b]));
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void EnvelopePyramid::Range(const double* raw, size_t begin, size_t end, double& lo, double& hi) const {
+    rangeOf(mins, maxs, count, raw, begin, end, lo, hi);
+}
+
+//------------------------------------------------------------------------------
+void EnvelopePyramid::Range(const float* raw, size_t begin, size_t end, double& lo, double& hi) const {
+    rangeOf(mins, maxs, count, raw, begin, end, lo, hi);
+}
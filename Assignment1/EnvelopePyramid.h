@@ -0,0 +1,33 @@
+#ifndef _ENVELOPEPYRAMIDH
+#define _ENVELOPEPYRAMIDH
+
+#include <cstddef>
+#include <vector>
+
+// Multi-resolution min/max summary of one waveform, maintained as samples are
+// appended. Level k stores the min and max of consecutive blocks of 4^k raw
+// samples, so the extremes of any index range are found by touching a few
+// blocks per level instead of every sample. The raw samples stay with the
+// caller (WaveformHistory); only the summary lives here.
+class EnvelopePyramid {
+    std::vector<std::vector<float>> mins; // mins[k-1][i] = min of block i at level k
+    std::vector<std::vector<float>> maxs; // maxs[k-1][i] = max of block i at level k
+    size_t count; // Raw samples appended so far
+    double maxAbs; // Running largest |value|
+
+public:
+    EnvelopePyramid();
+
+    void Append(double value); // Add the next raw sample
+    void Clear(); // Forget everything
+
+    size_t Size() const { return count; }
+    double MaxAbs() const { return maxAbs; }
+    size_t MemoryBytes() const; // Heap used by the levels
+
+    // Min and max of raw[begin, end); raw must be the same samples that were appended
+    void Range(const double* raw, size_t begin, size_t end, double& lo, double& hi) const;
+    void Range(const float* raw, size_t begin, size_t end, double& lo, double& hi) const;
+};
+
+#endif // _ENVELOPEPYRAMIDH
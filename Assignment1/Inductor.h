@@ -4,7 +4,7 @@
 
 
 // Inductor class derived from Component
-class Inductor : public Component {
+class Inductor final : public Component {
 	double inductance; //Inductance in henrys
 	double lastCurrent; // Last current through inductor
 public:
@@ -18,16 +18,40 @@ public:
         double voltage = inductance * (I - lastCurrent) / T;
         return voltage;
     }
+    //Backward Euler companion: V = (L / T) * I - (L / T) * lastCurrent
+    virtual void GetCompanion(double T, double& Req, double& Veq) override {
+        Req = inductance / T;
+        Veq = -inductance * lastCurrent / T;
+    }
     //Update the inductor state
     virtual void Update() override {
         // Update current after correct current is determined (called from CostFunctionV)
         // This will be called from AnalogCircuit after current is found
     }
 
+    //AC impedance  Z = j omega L
+    virtual std::complex<double> GetImpedance(double omega) const override {
+        return std::complex<double>(0.0, omega * inductance);
+    }
+
+    //Advance state after an MNA step
+    virtual void Commit(double I, double /*T*/) override {
+        lastCurrent = I;
+    }
+
+    //Checkpoint state
+    virtual int StateSize() const override { return 1; }
+    virtual void SaveState(std::vector<double>& out) const override { out.push_back(lastCurrent); }
+    virtual void LoadState(const double* in) override { lastCurrent = in[0]; }
+
 	//set the last current through the inductor
     void SetCurrent(double current) {
         lastCurrent = current;
     }
+	//get the last current through the inductor
+    double GetCurrent() const {
+        return lastCurrent;
+    }
 
 	//Display the inductor visually
     virtual void Display() override;
@@ -0,0 +1,101 @@
+// Instrumentation.cpp - Run statistics summaries
+
+#include "Instrumentation.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+static const char* counterNames[STAT_COUNT] = {
+    "steps", "rejected_steps", "non_converged", "alpha_halved", "alpha_reset", "frames" };
+static const char* phaseNames[PHASE_COUNT] = { "solve", "history", "output", "render" };
+
+//------------------------------------------------------------------------------
+void StatHistogram::Reset() {
+    for (auto& b : buckets) b.store(0, memory_order_relaxed);
+    count.store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    maxValue.store(0, memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Buckets are read one at a time, so a live quantile may be off by the values
+// added meanwhile
+uint64_t StatHistogram::Quantile(double q) const {
+    uint64_t n = 0;
+    for (int k = 0; k < bucketCount; ++k) n += BucketCount(k);
+    if (n == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * (n - 1)), seen = 0;
+    for (int k = 0; k < bucketCount; ++k) {
+        seen += BucketCount(k);
+        if (seen > rank) return k == 0 ? 0 : (uint64_t(1) << k) - 1;
+    }
+    return Max();
+}
+
+//------------------------------------------------------------------------------
+// Buckets are listed up to the last non-empty one as [upper bound, count]
+void StatHistogram::WriteJson(ostream& out) const {
+    out << "{\"count\": " << Count() << ", \"mean\": " << Mean() << ", \"max\": " << Max()
+        << ", \"p50\": " << Quantile(0.5) << ", \"p90\": " << Quantile(0.9) << ", \"p99\": " << Quantile(0.99)
+        << ", \"buckets\": [";
+    int last = -1;
+    for (int k = 0; k < bucketCount; ++k)
+        if (BucketCount(k)) last = k;
+    for (int k = 0; k <= last; ++k) {
+        uint64_t upper = k == 0 ? 0 : (uint64_t(1) << k) - 1;
+        out << (k ? ", " : "") << "[" << upper << ", " << BucketCount(k) << "]";
+    }
+    out << "]}";
+}
+
+//------------------------------------------------------------------------------
+void Instrumentation::Reset() {
+    for (auto& c : counters) c.store(0, memory_order_relaxed);
+    for (auto& p : phaseNanos) p.store(0, memory_order_relaxed);
+    stepNanos.Reset();
+    iterations.Reset();
+}
+
+//------------------------------------------------------------------------------
+string Instrumentation::Summary() const {
+    ostringstream s;
+    s << "steps " << Counter(STAT_STEPS) << ", mean step " << stepNanos.Mean() * 1e-3 << " us"
+        << ", p99 " << stepNanos.Quantile(0.99) * 1e-3 << " us";
+    if (iterations.Count()) s << ", iterations/step " << iterations.Mean() << " (max " << iterations.Max() << ")";
+    if (Counter(STAT_NON_CONVERGED)) s << ", non-converged " << Counter(STAT_NON_CONVERGED);
+    if (Counter(STAT_REJECTED)) s << ", rejected " << Counter(STAT_REJECTED);
+    return s.str();
+}
+
+//------------------------------------------------------------------------------
+void Instrumentation::WriteJson(ostream& out) const {
+    out << "{\n  \"instrumented\": " << (ANASIM_INSTRUMENTED ? "true" : "false") << ",\n  \"counters\": {";
+    for (int c = 0; c < STAT_COUNT; ++c)
+        out << (c ? ", " : "") << "\"" << counterNames[c] << "\": " << Counter(StatCounter(c));
+    out << "},\n  \"phase_seconds\": {";
+    for (int p = 0; p < PHASE_COUNT; ++p)
+        out << (p ? ", " : "") << "\"" << phaseNames[p] << "\": " << PhaseSeconds(StatPhase(p));
+    out << "},\n  \"step_ns\": ";
+    stepNanos.WriteJson(out);
+    out << ",\n  \"solver_iterations\": ";
+    iterations.WriteJson(out);
+    out << "\n}\n";
+}
+
+//------------------------------------------------------------------------------
+bool Instrumentation::WriteJson(const string& filename) const {
+    if (filename == "-") {
+        WriteJson(cout);
+        return true;
+    }
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open " << filename << " for writing" << endl;
+        return false;
+    }
+    WriteJson(out);
+    return true;
+}
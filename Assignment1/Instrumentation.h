@@ -0,0 +1,132 @@
+#ifndef _INSTRUMENTATIONH
+#define _INSTRUMENTATIONH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Low-overhead run statistics: event counters, time per phase of a step and
+// log2 histograms of step time and solver iterations.
+//
+// Every field is a relaxed atomic with exactly one writing thread, so an
+// update is a plain load and store (no locked instruction) and any other
+// thread may read live values while the simulation runs. The simulation
+// thread owns the solver fields; a viewer's display thread owns the history
+// and render phases.
+//
+// Building with -DANASIM_NO_INSTRUMENTATION compiles every probe out: Now()
+// returns 0, the update functions are empty and the summary reports
+// "instrumented": false.
+
+#ifdef ANASIM_NO_INSTRUMENTATION
+#define ANASIM_INSTRUMENTED false
+#else
+#define ANASIM_INSTRUMENTED true
+#endif
+
+// Parts of the step loop timed separately
+enum StatPhase {
+    PHASE_SOLVE,   // Solver and adaptive step control
+    PHASE_HISTORY, // Appending to the drawing history (viewer)
+    PHASE_OUTPUT,  // Formatting data file rows
+    PHASE_RENDER,  // Drawing a frame (viewer)
+    PHASE_COUNT
+};
+
+// Events counted over a run
+enum StatCounter {
+    STAT_STEPS,         // Accepted time steps
+    STAT_REJECTED,      // Adaptive steps retried with a smaller step
+    STAT_NON_CONVERGED, // Solves that hit their iteration limit
+    STAT_ALPHA_HALVED,  // Heuristic solver: step size alpha halved
+    STAT_ALPHA_RESET,   // Heuristic solver: alpha fell too low and was reset
+    STAT_FRAMES,        // Frames drawn (viewer)
+    STAT_COUNT
+};
+
+// Histogram with power-of-two buckets: bucket 0 holds 0, bucket k holds
+// [2^(k-1), 2^k). Covers nanoseconds up to about 4.6 minutes.
+class StatHistogram {
+public:
+    static const int bucketCount = 40;
+
+private:
+    std::atomic<uint64_t> buckets[bucketCount]; // Values per bucket
+    std::atomic<uint64_t> count; // Values added
+    std::atomic<uint64_t> sum; // Total of the values
+    std::atomic<uint64_t> maxValue; // Largest value
+
+    static void Bump(std::atomic<uint64_t>& a, uint64_t by) {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+public:
+    StatHistogram() { Reset(); }
+
+    static int Bucket(uint64_t value) {
+        int k = 0;
+        while (value && k < bucketCount - 1) { value >>= 1; k++; }
+        return k;
+    }
+
+    void Add(uint64_t value) {
+        if (!ANASIM_INSTRUMENTED) return;
+        Bump(buckets[Bucket(value)], 1);
+        Bump(count, 1);
+        Bump(sum, value);
+        if (value > maxValue.load(std::memory_order_relaxed)) maxValue.store(value, std::memory_order_relaxed);
+    }
+
+    void Reset();
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    uint64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return maxValue.load(std::memory_order_relaxed); }
+    uint64_t BucketCount(int k) const { return buckets[k].load(std::memory_order_relaxed); }
+    double Mean() const { uint64_t n = Count(); return n ? double(Sum()) / n : 0.0; }
+    uint64_t Quantile(double q) const; // Upper bound of the bucket holding the q-quantile
+
+    void WriteJson(std::ostream& out) const; // {"count":..,"mean":..,"p50":..,"buckets":[..]}
+};
+
+class Instrumentation {
+    std::atomic<uint64_t> counters[STAT_COUNT];
+    std::atomic<uint64_t> phaseNanos[PHASE_COUNT];
+
+public:
+    StatHistogram stepNanos; // Wall time of each accepted step
+    StatHistogram iterations; // Solver iterations per step (heuristic and Newton solvers)
+
+    Instrumentation() { Reset(); }
+
+    // Monotonic nanoseconds, 0 when compiled out
+    static uint64_t Now() {
+        if (!ANASIM_INSTRUMENTED) return 0;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void Count(StatCounter c, uint64_t by = 1) {
+        if (!ANASIM_INSTRUMENTED) return;
+        counters[c].store(counters[c].load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    // Add the time since 'start' (from Now()) to a phase, returns Now() for chaining
+    uint64_t AddPhase(StatPhase p, uint64_t start) {
+        if (!ANASIM_INSTRUMENTED) return 0;
+        uint64_t now = Now();
+        phaseNanos[p].store(phaseNanos[p].load(std::memory_order_relaxed) + (now - start), std::memory_order_relaxed);
+        return now;
+    }
+
+    uint64_t Counter(StatCounter c) const { return counters[c].load(std::memory_order_relaxed); }
+    double PhaseSeconds(StatPhase p) const { return phaseNanos[p].load(std::memory_order_relaxed) * 1e-9; }
+
+    void Reset(); // Zero everything (not while another thread writes)
+    std::string Summary() const; // One line of live counters for progress output
+    void WriteJson(std::ostream& out) const; // Whole summary as one JSON object
+    bool WriteJson(const std::string& filename) const; // "-" = cout
+};
+
+#endif // _INSTRUMENTATIONH
@@ -0,0 +1,60 @@
+// LadderNetwork.cpp - RLC ladder generator
+
+#include "LadderNetwork.h"
+#include "MonteCarlo.h" // Counter-based uniform numbers
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+LadderNetwork::LadderNetwork(size_t sections, double r, double l, double c, double loadOhms,
+    double frequency, double peakVoltage)
+    : R(sections, r), L(sections, l), C(sections, c), load(loadOhms < 0.0 ? sqrt(l / c) : loadOhms),
+    freq(frequency), Vpeak(peakVoltage) {
+}
+
+//------------------------------------------------------------------------------
+void LadderNetwork::Spread(double fraction, uint64_t seed) {
+    for (size_t k = 0; k < Sections(); ++k) {
+        R[k] *= 1.0 + fraction * (2.0 * MonteCarlo::Uniform(seed, k, 0) - 1.0);
+        L[k] *= 1.0 + fraction * (2.0 * MonteCarlo::Uniform(seed, k, 1) - 1.0);
+        C[k] *= 1.0 + fraction * (2.0 * MonteCarlo::Uniform(seed, k, 2) - 1.0);
+    }
+}
+
+//------------------------------------------------------------------------------
+double LadderNetwork::SourceVoltage(double t) const {
+    return Vpeak * sin(2.0 * 3.14159265358979323846 * freq * t);
+}
+
+//------------------------------------------------------------------------------
+// %.17g keeps every value exact, so both engines see the same circuit
+bool LadderNetwork::WriteNetlist(const string& filename, double step, double stop, const vector<size_t>& probes) const {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open output file " << filename << endl;
+        return false;
+    }
+    char line[160];
+    out << "RLC ladder, " << Sections() << " sections\n";
+    snprintf(line, sizeof(line), "V1 n0 0 SIN(0 %.17g %.17g)\n", Vpeak, freq);
+    out << line;
+    for (size_t k = 1; k <= Sections(); ++k) {
+        snprintf(line, sizeof(line), "R%zu n%zu m%zu %.17g\nL%zu m%zu n%zu %.17g\nC%zu n%zu 0 %.17g\n",
+            k, k - 1, k, R[k - 1], k, k, k, L[k - 1], k, k, C[k - 1]);
+        out << line;
+    }
+    if (load > 0.0) {
+        snprintf(line, sizeof(line), "RLOAD n%zu 0 %.17g\n", Sections(), load);
+        out << line;
+    }
+    snprintf(line, sizeof(line), ".tran %.17g %.17g\n", step, stop);
+    out << line << ".print tran";
+    for (size_t node : probes) out << " V(n" << node << ")";
+    out << "\n.end\n";
+    return bool(out);
+}
@@ -0,0 +1,33 @@
+#ifndef _LADDERNETWORKH
+#define _LADDERNETWORKH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Chain of RLC sections, as used for transmission lines (equal sections) and
+// filter chains. A sine source drives node 0; section k (1..N) is R[k-1] and
+// L[k-1] in series from node k-1 to node k, with C[k-1] from node k to
+// ground; a load resistor ends the chain at node N.
+class LadderNetwork {
+public:
+    std::vector<double> R, L, C; // Per section
+    double load; // Ohms from node N to ground, 0 = open end
+    double freq, Vpeak; // Source sine
+
+    // N equal sections; load < 0 terminates in the characteristic impedance sqrt(L/C)
+    LadderNetwork(size_t sections, double r, double l, double c, double loadOhms, double frequency, double peakVoltage);
+
+    // Scatter every element by up to +-fraction (uniform), repeatable per seed
+    void Spread(double fraction, uint64_t seed);
+
+    size_t Sections() const { return R.size(); }
+    double SourceVoltage(double t) const; // Same expression as VoltageSource
+
+    // The same circuit in the netlist format of MnaCircuit (nodes n0..nN and
+    // m1..mN between each R and L), printing V() of the given nodes
+    bool WriteNetlist(const std::string& filename, double step, double stop, const std::vector<size_t>& probes) const;
+};
+
+#endif // _LADDERNETWORKH
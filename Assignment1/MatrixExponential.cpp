@@ -0,0 +1,85 @@
+// MatrixExponential.cpp - Pade scaling-and-squaring matrix exponential
+
+#include "MatrixExponential.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// C = A * B for n x n row-major matrices
+static void multiply(const vector<double>& A, const vector<double>& B, int n, vector<double>& C) {
+    C.assign(size_t(n) * n, 0.0);
+    for (int i = 0; i < n; ++i)
+        for (int k = 0; k < n; ++k) {
+            double a = A[size_t(i) * n + k];
+            if (a == 0.0) continue;
+            for (int j = 0; j < n; ++j) C[size_t(i) * n + j] += a * B[size_t(k) * n + j];
+        }
+}
+
+//------------------------------------------------------------------------------
+void MatrixExponential(const vector<double>& A, int n, vector<double>& E) {
+    const int q = 6; // Pade degree
+    size_t size = size_t(n) * n;
+
+    double norm = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (int j = 0; j < n; ++j) sum += fabs(A[size_t(i) * n + j]);
+        norm = max(norm, sum);
+    }
+    int s = norm > 0.5 ? static_cast<int>(ceil(log2(norm / 0.5))) : 0;
+    double scale = ldexp(1.0, -s);
+
+    // N = sum c_k X^k, D = sum (-1)^k c_k X^k, with X = A / 2^s
+    vector<double> X(size), P(size, 0.0), N(size, 0.0), D(size, 0.0), next;
+    for (size_t k = 0; k < size; ++k) X[k] = A[k] * scale;
+    for (int i = 0; i < n; ++i) P[size_t(i) * n + i] = 1.0;
+    double c = 1.0;
+    for (int k = 0; k <= q; ++k) {
+        if (k > 0) {
+            c *= double(q - k + 1) / (k * double(2 * q - k + 1));
+            multiply(P, X, n, next);
+            P.swap(next);
+        }
+        double sign = (k % 2) ? -1.0 : 1.0;
+        for (size_t m = 0; m < size; ++m) {
+            N[m] += c * P[m];
+            D[m] += sign * c * P[m];
+        }
+    }
+
+    // E = D^-1 N by Gauss-Jordan elimination with partial pivoting
+    for (int k = 0; k < n; ++k) {
+        int best = k;
+        for (int i = k + 1; i < n; ++i)
+            if (fabs(D[size_t(i) * n + k]) > fabs(D[size_t(best) * n + k])) best = i;
+        if (best != k)
+            for (int j = 0; j < n; ++j) {
+                swap(D[size_t(k) * n + j], D[size_t(best) * n + j]);
+                swap(N[size_t(k) * n + j], N[size_t(best) * n + j]);
+            }
+        double inv = 1.0 / D[size_t(k) * n + k];
+        for (int j = 0; j < n; ++j) {
+            D[size_t(k) * n + j] *= inv;
+            N[size_t(k) * n + j] *= inv;
+        }
+        for (int i = 0; i < n; ++i) {
+            double f = D[size_t(i) * n + k];
+            if (i == k || f == 0.0) continue;
+            for (int j = 0; j < n; ++j) {
+                D[size_t(i) * n + j] -= f * D[size_t(k) * n + j];
+                N[size_t(i) * n + j] -= f * N[size_t(k) * n + j];
+            }
+        }
+    }
+
+    E = N;
+    for (int k = 0; k < s; ++k) {
+        multiply(E, E, n, next);
+        E.swap(next);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _MATRIXEXPONENTIALH
+#define _MATRIXEXPONENTIALH
+
+#include <vector>
+
+// E = exp(A) for a small dense n x n matrix, both row-major. Diagonal Pade
+// approximant of degree 6 with scaling and squaring: A is halved s times until
+// its infinity norm is at most 1/2, where the approximant is accurate to
+// double precision, and the result is squared s times.
+void MatrixExponential(const std::vector<double>& A, int n, std::vector<double>& E);
+
+#endif // _MATRIXEXPONENTIALH
@@ -0,0 +1,398 @@
+// MnaCircuit.cpp - Netlist loading and modified nodal analysis transient engine
+
+#include "MnaCircuit.h"
+#include "Capacitor.h" // Include the header file for the Capacitor class
+#include "CurrentSource.h" // Include the header file for the CurrentSource class
+#include "Diode.h" // Include the header file for the Diode class
+#include "Inductor.h" // Include the header file for the Inductor class
+#include "Resistor.h" // Include the header file for the Resistor class
+#include "SaturableInductor.h" // Include the header file for the SaturableInductor class
+#include "VoltageSource.h" // Include the header file for the VoltageSource class
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// Upper-case copy for case-insensitive keywords
+static string upper(string s) {
+    for (auto& ch : s) ch = static_cast<char>(toupper(static_cast<unsigned char>(ch)));
+    return s;
+}
+
+//------------------------------------------------------------------------------
+MnaCircuit::MnaCircuit()
+    : T(0.0001), stampedFor(0.0), refactor(false), timeMax(0.1), currentTime(0.0), stepCount(0),
+    simulationComplete(false), factorTime(0.0), newtonIterations(0), maxStepIterations(0), nonConverged(0) {
+    nodeIndex["0"] = 0;
+    nodeNames.push_back("0");
+}
+
+//------------------------------------------------------------------------------
+MnaCircuit::~MnaCircuit() {
+    for (auto& c : extras) delete c;
+    extras.clear();
+    components.clear();
+    fout.Close();
+}
+
+//------------------------------------------------------------------------------
+// Number followed by an optional SPICE scale suffix; trailing units are ignored
+bool MnaCircuit::ParseValue(const string& text, double& value) {
+    istringstream in(text);
+    if (!(in >> value)) return false;
+    string suffix;
+    in >> suffix;
+    suffix = upper(suffix);
+    if (suffix.compare(0, 3, "MEG") == 0) value *= 1e6;
+    else if (suffix.compare(0, 3, "MIL") == 0) value *= 25.4e-6;
+    else if (!suffix.empty()) {
+        switch (suffix[0]) {
+        case 'T': value *= 1e12; break;
+        case 'G': value *= 1e9; break;
+        case 'K': value *= 1e3; break;
+        case 'M': value *= 1e-3; break;
+        case 'U': value *= 1e-6; break;
+        case 'N': value *= 1e-9; break;
+        case 'P': value *= 1e-12; break;
+        case 'F': value *= 1e-15; break;
+        default: break; // Plain unit such as V or A
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int MnaCircuit::Node(const string& name) {
+    string key = upper(name);
+    if (key == "GND") key = "0";
+    auto it = nodeIndex.find(key);
+    if (it != nodeIndex.end()) return it->second;
+    int index = static_cast<int>(nodeNames.size());
+    nodeIndex[key] = index;
+    nodeNames.push_back(name);
+    return index;
+}
+
+//------------------------------------------------------------------------------
+void MnaCircuit::AddComponent(Component* c, const string& a, const string& b) {
+    c->SetNodes(Node(a), Node(b));
+    extras.push_back(c);
+    stampedFor = 0.0; // Topology changed
+}
+
+//------------------------------------------------------------------------------
+// Resolve "V(node)" or "I(element)" to an output column
+bool MnaCircuit::AddPrint(const string& item) {
+    string key = upper(item);
+    if (key.size() < 4 || key[1] != '(' || key.back() != ')') return false;
+    string inner = item.substr(2, item.size() - 3);
+
+    if (key[0] == 'V') {
+        string nodeKey = upper(inner);
+        if (nodeKey == "GND") nodeKey = "0";
+        auto it = nodeIndex.find(nodeKey);
+        if (it == nodeIndex.end()) return false;
+        prints.push_back(PrintItem{ false, it->second, "V(" + inner + ")", "" });
+        return true;
+    }
+    if (key[0] == 'I') {
+        bool found = false;
+        ForEachElement([&](Component& c) { found = found || upper(c.GetName()) == upper(inner); });
+        if (found) prints.push_back(PrintItem{ true, -1, "I(" + inner + ")", upper(inner) });
+        return found;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Parse one statement; element lines create components
+bool MnaCircuit::ParseLine(const string& rawLine, int lineNumber) {
+    // Parentheses and commas only separate tokens
+    string line = rawLine;
+    for (auto& ch : line) if (ch == '(' || ch == ')' || ch == ',' || ch == '=') ch = ' ';
+
+    istringstream in(line);
+    vector<string> tok;
+    string word;
+    while (in >> word) tok.push_back(word);
+    if (tok.empty() || tok[0][0] == '*') return true;
+
+    string kind = upper(tok[0]);
+    auto fail = [&](const string& why) {
+        cerr << "Error: netlist line " << lineNumber << ": " << why << endl;
+        return false;
+    };
+
+    if (kind[0] == '.') {
+        if (kind == ".END") return true;
+        if (kind == ".TRAN") {
+            double step, stop;
+            if (tok.size() < 3 || !ParseValue(tok[1], step) || !ParseValue(tok[2], stop) || step <= 0.0)
+                return fail("expected .tran step stop");
+            SetTransient(step, stop);
+            return true;
+        }
+        if (kind == ".PRINT") {
+            // Rebuild items from the raw text so V(n) keeps its parentheses
+            istringstream raw(rawLine);
+            string item;
+            raw >> item; // .print
+            while (raw >> item) {
+                if (upper(item) == "TRAN") continue;
+                if (!AddPrint(item)) return fail("unknown print item " + item);
+            }
+            return true;
+        }
+        return true; // Other dot commands are ignored
+    }
+
+    // Optional NAME=value parameters, searched from token "from" on
+    auto param = [&](size_t from, const string& key, double& out) {
+        for (size_t i = from; i + 1 < tok.size(); i += 2)
+            if (upper(tok[i]) == key) return ParseValue(tok[i + 1], out);
+        return false;
+    };
+
+    if (kind[0] == 'D') {
+        double is = 1e-14, emission = 1.0;
+        if (tok.size() < 3) return fail("expected name and two nodes");
+        param(3, "IS", is);
+        param(3, "N", emission);
+        if (is <= 0.0 || emission <= 0.0) return fail("bad diode parameters");
+        AddElement<Diode>(tok[1], tok[2], is, emission, 1.0f, 1.0f, 0.0f, tok[0]);
+        return true;
+    }
+
+    if (tok.size() < 4) return fail("expected name, two nodes and a value");
+    const string& name = tok[0];
+    double value = 0.0;
+
+    if (kind[0] == 'R' || kind[0] == 'C' || kind[0] == 'L') {
+        if (!ParseValue(tok[3], value) || value <= 0.0) return fail("bad value " + tok[3]);
+        double ic = 0.0, isat = 0.0;
+        bool hasIc = param(4, "IC", ic);
+
+        if (kind[0] == 'R') AddElement<Resistor>(tok[1], tok[2], value, 1.0f, 0.0f, 0.0f, name);
+        else if (kind[0] == 'C') {
+            Capacitor& c = AddElement<Capacitor>(tok[1], tok[2], value, 0.0f, 1.0f, 0.0f, name);
+            if (hasIc) c.SetVoltage(ic);
+        }
+        else if (param(4, "ISAT", isat)) {
+            if (isat <= 0.0) return fail("bad ISAT");
+            SaturableInductor& l = AddElement<SaturableInductor>(tok[1], tok[2], value, isat, 0.0f, 1.0f, 1.0f, name);
+            if (hasIc) l.Commit(ic, T);
+        }
+        else {
+            Inductor& l = AddElement<Inductor>(tok[1], tok[2], value, 0.0f, 0.0f, 1.0f, name);
+            if (hasIc) l.SetCurrent(ic);
+        }
+        return true;
+    }
+
+    if (kind[0] == 'V' || kind[0] == 'I') {
+        double dc = 0.0, amp = 0.0, freq = 0.0;
+        size_t i = 3;
+        if (upper(tok[i]) == "DC") i++;
+        if (i < tok.size() && upper(tok[i]) == "SIN") {
+            if (tok.size() < i + 4 || !ParseValue(tok[i + 1], dc) || !ParseValue(tok[i + 2], amp) || !ParseValue(tok[i + 3], freq))
+                return fail("expected SIN(offset amplitude freq)");
+        }
+        else if (i >= tok.size() || !ParseValue(tok[i], dc)) return fail("bad source value");
+
+        if (kind[0] == 'V') AddElement<VoltageSource>(tok[1], tok[2], dc, amp, freq, 1.0f, 1.0f, 1.0f, name);
+        else AddElement<CurrentSource>(tok[1], tok[2], dc, amp, freq, 1.0f, 1.0f, 1.0f, name);
+        return true;
+    }
+
+    return fail("unsupported element " + name);
+}
+
+//------------------------------------------------------------------------------
+bool MnaCircuit::LoadNetlist(const string& filename) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open netlist " << filename << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    vector<pair<int, string>> printLines; // .print needs every element defined first
+    while (getline(in, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (lineNumber == 1) { title = line; continue; }
+        if (upper(line).compare(0, 6, ".PRINT") == 0) { printLines.emplace_back(lineNumber, line); continue; }
+        if (!ParseLine(line, lineNumber)) return false;
+    }
+    for (auto& p : printLines)
+        if (!ParseLine(p.second, p.first)) return false;
+
+    if (ComponentCount() == 0) {
+        cerr << "Error: netlist " << filename << " has no elements" << endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Give every branch element its extra unknown and size the system
+bool MnaCircuit::Prepare() {
+    // The element arrays are final now, so the virtual view can be taken
+    components.clear();
+    elements.Pointers(components);
+    components.insert(components.end(), extras.begin(), extras.end());
+
+    for (auto& p : prints) {
+        if (!p.isCurrent) continue;
+        for (size_t i = 0; i < components.size(); ++i)
+            if (upper(components[i]->GetName()) == p.element) p.index = static_cast<int>(i);
+    }
+
+    int branches = 0;
+    for (auto& c : components) {
+        if (c->BranchCount() > 0) c->SetBranch(branches);
+        branches += c->BranchCount();
+    }
+    mna.Resize(NodeCount(), branches);
+    stampedFor = 0.0;
+
+    nonlinear.clear();
+    for (auto& c : components)
+        if (c->IsNonlinear()) nonlinear.push_back(c);
+
+    // Default output: every node voltage
+    if (prints.empty())
+        for (int n = 1; n < NodeCount(); ++n)
+            prints.push_back(PrintItem{ false, n, "V(" + nodeNames[n] + ")", "" });
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool MnaCircuit::run(const string& filename) {
+    if (!Prepare()) return false;
+    currentTime = 0.0;
+    stepCount = 0;
+    simulationComplete = false;
+    outputFile = filename;
+
+    if (!filename.empty()) {
+        if (!fout.Open(filename)) {
+            cerr << "Error: Could not open output file " << filename << endl;
+            return false;
+        }
+        vector<string> names{ "Time" };
+        for (auto& p : prints) names.push_back(p.label);
+        fout.WriteHeader(names);
+    }
+    row.resize(prints.size() + 1);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool MnaCircuit::StampAndFactor() {
+    auto begin = chrono::steady_clock::now();
+    mna.ClearMatrix();
+    ForEachElement([&](auto& c) { c.StampMatrix(mna, T); });
+    bool ok = mna.Factor();
+    factorTime += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (!ok) cerr << "Error: singular circuit matrix (floating node or source loop?)" << endl;
+    stampedFor = T;
+    refactor = false;
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Restamp and factor only when T changes (the symbolic analysis survives even
+// that); each step then needs only the right-hand side and a forward/back
+// substitution. Nonlinear elements add Newton iterations around that solve.
+// Their slopes are stamped into the matrix, but the factors are kept (chord
+// iterations, also across steps) until some element's slope has drifted by
+// more than 30% or convergence stalls.
+bool MnaCircuit::runStep() {
+    if (currentTime >= timeMax || simulationComplete) {
+        simulationComplete = true;
+        return false;
+    }
+
+    const int maxIterations = 50;
+    int iterations = 0;
+    for (;;) {
+        if (stampedFor != T || !mna.IsFactored() || refactor) {
+            if (!StampAndFactor()) {
+                simulationComplete = true;
+                return false;
+            }
+        }
+
+        mna.ClearRhs();
+        ForEachElement([&](auto& c) { c.StampRhs(mna, currentTime, T); });
+        mna.Solve();
+        if (nonlinear.empty()) break;
+
+        iterations++;
+        bool settled = true;
+        double drift = 0.0;
+        for (auto& c : nonlinear) {
+            settled = c->NewtonUpdate(mna, T) && settled;
+            drift = max(drift, c->JacobianDrift());
+        }
+        if (settled) break;
+        if (iterations >= maxIterations) {
+            nonConverged++;
+            break;
+        }
+        if (drift > 0.3 || iterations % 4 == 0) refactor = true;
+    }
+    newtonIterations += iterations;
+    maxStepIterations = max(maxStepIterations, iterations);
+
+    ForEachElement([&](auto& c) { c.AcceptSolution(mna, T); });
+
+    if (fout.IsOpen()) {
+        row[0] = currentTime;
+        for (size_t i = 0; i < prints.size(); ++i) {
+            const PrintItem& p = prints[i];
+            row[i + 1] = p.isCurrent ? components[p.index]->GetBranchCurrent() : mna.NodeVoltage(p.index);
+        }
+        fout.WriteRow(row.data(), static_cast<int>(row.size()));
+    }
+
+    currentTime += T;
+    stepCount++;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int MnaCircuit::runToCompletion() {
+    while (runStep()) {}
+    return stepCount;
+}
+
+//------------------------------------------------------------------------------
+bool MnaCircuit::CloseOutput() {
+    if (fout.Close()) return true;
+    cerr << "Error: Could not write data file " << outputFile << endl;
+    return false;
+}
+
+//------------------------------------------------------------------------------
+double MnaCircuit::NodeVoltage(const string& name) const {
+    string key = upper(name);
+    if (key == "GND") key = "0";
+    auto it = nodeIndex.find(key);
+    return it == nodeIndex.end() ? 0.0 : mna.NodeVoltage(it->second);
+}
+
+//------------------------------------------------------------------------------
+void VoltageSource::Display() {
+}
+
+void CurrentSource::Display() {
+}
@@ -0,0 +1,113 @@
+#ifndef _MNACIRCUITH
+#define _MNACIRCUITH
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Capacitor.h" // Element types stored by value
+#include "ComponentStore.h" // Devirtualised component containers
+#include "CurrentSource.h"
+#include "Diode.h"
+#include "Inductor.h"
+#include "Resistor.h"
+#include "SaturableInductor.h"
+#include "VoltageSource.h"
+#include "MnaSystem.h" // Nodal analysis matrix
+#include "TraceWriter.h" // Buffered background file output
+
+// General circuit built from a netlist and solved by modified nodal analysis.
+// Every component stamps its companion model into one system matrix, so
+// any topology works: parallel branches, several sources, long ladders.
+//
+// Netlist subset (SPICE-like, first line is the title, case-insensitive):
+//   Rname n+ n- value
+//   Cname n+ n- value [IC=volts]
+//   Lname n+ n- value [IC=amps] [ISAT=amps]   (ISAT makes the core saturable)
+//   Dname anode cathode [IS=amps] [N=emission]
+//   Vname n+ n- [DC] value | SIN(offset amplitude freq)
+//   Iname n+ n- [DC] value | SIN(offset amplitude freq)
+//   .tran step stop
+//   .print tran V(node) I(element) ...
+//   .end
+// Values accept the usual suffixes (f p n u m k meg g t); node 0 or gnd is ground.
+class MnaCircuit {
+    // One output column
+    struct PrintItem {
+        bool isCurrent; // true = I(element), false = V(node)
+        int index; // Node number or component index (resolved by Prepare)
+        std::string label; // Column heading
+        std::string element; // Element name for I(element)
+    };
+
+    // Netlist elements live by value in one array per type, so the stamping
+    // loops call each concrete class directly; components is the virtual view
+    ComponentStore<Resistor, Capacitor, Inductor, VoltageSource, CurrentSource, Diode, SaturableInductor> elements;
+    std::vector<Component*> extras; // Added through AddComponent(), owned
+    std::vector<Component*> components; // Every element, built by Prepare()
+    std::vector<Component*> nonlinear; // Elements that need Newton iterations
+    std::map<std::string, int> nodeIndex; // Node name -> number (0 = ground)
+    std::vector<std::string> nodeNames; // Node number -> name
+    std::vector<PrintItem> prints; // Output columns after Time
+    std::vector<double> row; // Output row buffer
+    MnaSystem mna; // System matrix and solution
+    double T; // Time step
+    double stampedFor; // Time step the matrix was last stamped and factored for
+    bool refactor; // Nonlinear slopes drifted, restamp before the next solve
+    TraceWriter fout; // Data file output
+    std::string outputFile; // Its name, for messages
+
+    bool ParseLine(const std::string& line, int lineNumber); // One netlist statement
+    bool Prepare(); // Number unknowns and build the matrix
+    bool StampAndFactor(); // Restamp the matrix at the present operating points
+
+    // Call f on every element: stored types directly, extras through the vtable
+    template <class F>
+    void ForEachElement(F&& f) {
+        elements.ForEach(f);
+        for (auto& c : extras) f(*c);
+    }
+
+public:
+    double timeMax; // Stop time
+    double currentTime; // Current simulation time
+    int stepCount; // Number of simulation steps taken
+    bool simulationComplete; // True when simulation has finished
+    std::string title; // Netlist title line
+    double factorTime; // Seconds spent stamping and factoring the matrix
+    long long newtonIterations; // Newton solves over all steps (nonlinear circuits only)
+    int maxStepIterations; // Most Newton solves any single step needed
+    int nonConverged; // Steps that hit the Newton iteration limit
+
+    MnaCircuit();
+    ~MnaCircuit();
+
+    static bool ParseValue(const std::string& text, double& value); // Number with SPICE suffix
+
+    bool LoadNetlist(const std::string& filename); // Parse a netlist file
+    int Node(const std::string& name); // Node number, created on first use
+    void AddComponent(Component* c, const std::string& a, const std::string& b); // Takes ownership, called through the vtable
+
+    // Create a stored element (one of the types in elements) between two named nodes
+    template <class T, class... Args>
+    T& AddElement(const std::string& a, const std::string& b, Args&&... args) {
+        T& c = elements.Add<T>(std::forward<Args>(args)...);
+        c.SetNodes(Node(a), Node(b));
+        stampedFor = 0.0; // Topology changed
+        return c;
+    }
+    void SetTransient(double step, double stop) { T = step; timeMax = stop; }
+    bool AddPrint(const std::string& item); // "V(node)" or "I(element)"
+
+    bool run(const std::string& filename); // Prepare and write the header, empty name = no file
+    bool runStep(); // Solve one time step
+    int runToCompletion(); // Run all remaining steps, returns step count
+    bool CloseOutput(); // Finish the data file, false (with a message) if any row could not be written
+
+    int NodeCount() const { return static_cast<int>(nodeNames.size()); } // Including ground
+    size_t ComponentCount() const { return elements.Size() + extras.size(); }
+    double NodeVoltage(const std::string& name) const; // Voltage at the last step
+    double NodeVoltage(int node) const { return mna.NodeVoltage(node); }
+    const MnaSystem& System() const { return mna; } // Matrix size and factor statistics
+};
+
+#endif // _MNACIRCUITH
@@ -0,0 +1,298 @@
+// MnaSystem.cpp - Modified nodal analysis matrix and default component stamps
+
+#include "MnaSystem.h"
+#include "Component.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+MnaSystem::MnaSystem()
+    : nodeCount(1), branchCount(0), n(0), factored(false), analyzed(false), matrixNonZeros(0),
+    factorFlops(0.0), dense(false), analyzeCount(0), factorCount(0) {
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::Resize(int nodes, int branches) {
+    nodeCount = nodes;
+    branchCount = branches;
+    n = nodes - 1 + branches;
+    entries.clear();
+    b.assign(n, 0.0);
+    x.assign(n, 0.0);
+    work.assign(n, 0.0);
+    factored = false;
+    analyzed = false;
+    dense = false;
+    A.clear();
+    pivot.clear();
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::ClearMatrix() {
+    entries.clear();
+    factored = false;
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::AddEntry(int row, int col, double value) {
+    if (row < 0 || col < 0) return; // Ground
+    entries.push_back(Entry{ row, col, value });
+    factored = false;
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::AddConductance(int a, int bNode, double g) {
+    int i = NodeUnknown(a), j = NodeUnknown(bNode);
+    AddEntry(i, i, g);
+    AddEntry(j, j, g);
+    AddEntry(i, j, -g);
+    AddEntry(j, i, -g);
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::ClearRhs() {
+    fill(b.begin(), b.end(), 0.0);
+}
+
+//------------------------------------------------------------------------------
+void MnaSystem::AddRhs(int row, double value) {
+    if (row >= 0) b[row] += value;
+}
+
+//------------------------------------------------------------------------------
+// Element carrying current from node a to node bNode: drawn out of a, delivered into bNode
+void MnaSystem::AddCurrent(int a, int bNode, double current) {
+    AddRhs(NodeUnknown(a), -current);
+    AddRhs(NodeUnknown(bNode), current);
+}
+
+//------------------------------------------------------------------------------
+// Symbolic phase. MNA stamps are structurally symmetric, so the elimination
+// graph of A + A^T gives both the ordering and the fill. Unknowns are
+// eliminated greedily by minimum degree, but only once their diagonal is
+// structurally nonzero: branch unknowns, and nodes touched only by sources,
+// start with an empty diagonal and must wait until eliminating a neighbour
+// fills it.
+void MnaSystem::Analyze() {
+    vector<set<int>> adj(n);
+    vector<char> hasDiag(n, 0);
+    for (auto& e : entries) {
+        if (e.row == e.col) {
+            if (e.value != 0.0) hasDiag[e.row] = 1;
+            continue;
+        }
+        adj[e.row].insert(e.col);
+        adj[e.col].insert(e.row);
+    }
+    matrixNonZeros = 0;
+    for (int i = 0; i < n; ++i) matrixNonZeros += adj[i].size() + hasDiag[i];
+
+    // Candidates sorted by (empty diagonal, degree, unknown)
+    auto key = [&](int u) { return make_pair(make_pair(1 - int(hasDiag[u]), int(adj[u].size())), u); };
+    set<pair<pair<int, int>, int>> ready;
+    for (int i = 0; i < n; ++i) ready.insert(key(i));
+
+    perm.assign(n, 0);
+    permInv.assign(n, -1);
+    vector<vector<int>> later(n); // Neighbours still present when each unknown is eliminated
+    for (int k = 0; k < n; ++k) {
+        int v = ready.begin()->second; // A structurally singular system ends up on the dense path
+        ready.erase(ready.begin());
+        perm[k] = v;
+        permInv[v] = k;
+
+        vector<int> nb(adj[v].begin(), adj[v].end());
+        later[v] = nb;
+        for (int u : nb) {
+            ready.erase(key(u));
+            adj[u].erase(v);
+            for (int w : nb) if (w != u) adj[u].insert(w); // Fill: neighbours of v become a clique
+            hasDiag[u] = 1; // Eliminating v updates every neighbour's diagonal
+            ready.insert(key(u));
+        }
+        adj[v].clear();
+    }
+
+    // Filled pattern in permuted order: row k has L columns from earlier
+    // pivots that reached it, its diagonal, and U columns from later[]
+    vector<vector<int>> rows(n);
+    for (int k = 0; k < n; ++k) {
+        rows[k].push_back(k);
+        for (int u : later[perm[k]]) {
+            int j = permInv[u];
+            rows[k].push_back(j);
+            rows[j].push_back(k);
+        }
+    }
+    rowStart.assign(n + 1, 0);
+    colIndex.clear();
+    diagPos.assign(n, 0);
+    factorFlops = 0.0;
+    for (int k = 0; k < n; ++k) {
+        sort(rows[k].begin(), rows[k].end());
+        rowStart[k] = static_cast<int>(colIndex.size());
+        for (int j : rows[k]) {
+            if (j == k) diagPos[k] = static_cast<int>(colIndex.size());
+            colIndex.push_back(j);
+        }
+    }
+    rowStart[n] = static_cast<int>(colIndex.size());
+    for (int k = 0; k < n; ++k) {
+        double lower = diagPos[k] - rowStart[k];
+        factorFlops += lower * (rowStart[k + 1] - diagPos[k]); // Row updates, by symmetry of the pattern
+    }
+    values.assign(colIndex.size(), 0.0);
+    analyzed = true;
+    analyzeCount++;
+}
+
+//------------------------------------------------------------------------------
+bool MnaSystem::Assemble() {
+    fill(values.begin(), values.end(), 0.0);
+    for (auto& e : entries) {
+        int i = permInv[e.row], j = permInv[e.col];
+        auto first = colIndex.begin() + rowStart[i], last = colIndex.begin() + rowStart[i + 1];
+        auto it = lower_bound(first, last, j);
+        if (it == last || *it != j) return false; // New position, pattern changed
+        values[it - colIndex.begin()] += e.value;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Numeric phase, row by row: each row is scattered into work, reduced by the
+// U rows of its L columns in order, then gathered back
+bool MnaSystem::FactorSparse() {
+    fill(work.begin(), work.end(), 0.0);
+    for (int i = 0; i < n; ++i) {
+        double rowMax = 0.0;
+        for (int p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+            work[colIndex[p]] = values[p];
+            rowMax = max(rowMax, fabs(values[p]));
+        }
+        for (int p = rowStart[i]; p < diagPos[i]; ++p) {
+            int k = colIndex[p];
+            double lik = work[k] / values[diagPos[k]];
+            work[k] = lik;
+            if (lik == 0.0) continue;
+            for (int q = diagPos[k] + 1; q < rowStart[k + 1]; ++q) work[colIndex[q]] -= lik * values[q];
+        }
+        for (int p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+            values[p] = work[colIndex[p]];
+            work[colIndex[p]] = 0.0;
+        }
+        if (fabs(values[diagPos[i]]) <= 1e-13 * rowMax || rowMax == 0.0) return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// In-place Doolittle LU with partial pivoting
+bool MnaSystem::FactorDense() {
+    A.assign(size_t(n) * n, 0.0);
+    pivot.assign(n, 0);
+    for (auto& e : entries) A[size_t(e.row) * n + e.col] += e.value;
+
+    for (int k = 0; k < n; ++k) {
+        int best = k;
+        for (int i = k + 1; i < n; ++i)
+            if (fabs(A[size_t(i) * n + k]) > fabs(A[size_t(best) * n + k])) best = i;
+        pivot[k] = best;
+        if (A[size_t(best) * n + k] == 0.0) return false;
+        if (best != k)
+            for (int j = 0; j < n; ++j) swap(A[size_t(k) * n + j], A[size_t(best) * n + j]);
+
+        double inv = 1.0 / A[size_t(k) * n + k];
+        for (int i = k + 1; i < n; ++i) {
+            double& lik = A[size_t(i) * n + k];
+            if (lik == 0.0) continue; // MNA matrices are mostly zeros
+            lik *= inv;
+            const double* rowK = &A[size_t(k) * n];
+            double* rowI = &A[size_t(i) * n];
+            for (int j = k + 1; j < n; ++j) rowI[j] -= lik * rowK[j];
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Reuse the symbolic analysis while the pattern is unchanged; only a new
+// pattern or a failed static pivot costs more than the numeric phase
+bool MnaSystem::Factor() {
+    factored = false;
+    if (!analyzed || !Assemble()) {
+        Analyze();
+        Assemble();
+    }
+    factorCount++;
+    dense = !FactorSparse();
+    if (dense && !FactorDense()) return false;
+    factored = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Forward and back substitution with the stored factors
+void MnaSystem::Solve() {
+    if (dense) {
+        x = b;
+        for (int k = 0; k < n; ++k)
+            if (pivot[k] != k) swap(x[k], x[pivot[k]]);
+        for (int i = 0; i < n; ++i) {
+            const double* row = &A[size_t(i) * n];
+            double sum = x[i];
+            for (int j = 0; j < i; ++j) sum -= row[j] * x[j];
+            x[i] = sum;
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            const double* row = &A[size_t(i) * n];
+            double sum = x[i];
+            for (int j = i + 1; j < n; ++j) sum -= row[j] * x[j];
+            x[i] = sum / row[i];
+        }
+        return;
+    }
+
+    double* y = work.data(); // Permuted solution
+    for (int i = 0; i < n; ++i) {
+        double sum = b[perm[i]];
+        for (int p = rowStart[i]; p < diagPos[i]; ++p) sum -= values[p] * y[colIndex[p]];
+        y[i] = sum;
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = y[i];
+        for (int p = diagPos[i] + 1; p < rowStart[i + 1]; ++p) sum -= values[p] * y[colIndex[p]];
+        y[i] = sum / values[diagPos[i]];
+        x[perm[i]] = y[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+// Default component stamps: Norton equivalent of the companion model.
+// Current from A to B is I = (vA - vB - Veq) / Req.
+void Component::StampMatrix(MnaSystem& mna, double timestep) {
+    double Req, Veq;
+    GetCompanion(timestep, Req, Veq);
+    mna.AddConductance(nodeA, nodeB, 1.0 / Req);
+}
+
+//------------------------------------------------------------------------------
+void Component::StampRhs(MnaSystem& mna, double /*time*/, double timestep) {
+    double Req, Veq;
+    GetCompanion(timestep, Req, Veq);
+    // The -Veq/Req part of I is a source pushing current from B to A
+    mna.AddCurrent(nodeB, nodeA, Veq / Req);
+}
+
+//------------------------------------------------------------------------------
+void Component::AcceptSolution(const MnaSystem& mna, double timestep) {
+    double Req, Veq;
+    GetCompanion(timestep, Req, Veq);
+    branchCurrent = (mna.NodeVoltage(nodeA) - mna.NodeVoltage(nodeB) - Veq) / Req;
+    Commit(branchCurrent, timestep);
+}
@@ -0,0 +1,94 @@
+#ifndef _MNASYSTEMH
+#define _MNASYSTEMH
+
+#include <cstddef>
+#include <vector>
+
+// Modified nodal analysis system  A x = b.
+// Unknowns are the node voltages 1..nodes-1 (node 0 is ground and has no
+// unknown) followed by one extra unknown per branch that needs it, such as
+// a voltage source current. Components stamp into it through the helpers.
+//
+// A is sparse. Factor() runs a symbolic analysis the first time it sees a
+// sparsity pattern (minimum degree ordering and the fill it causes) and keeps
+// it; later factorizations with the same pattern only redo the numeric phase.
+// If a pivot in that static order is numerically zero, the system falls back
+// to dense LU with partial pivoting.
+class MnaSystem {
+    // One stamped contribution, summed into A by Factor()
+    struct Entry {
+        int row;
+        int col;
+        double value;
+    };
+
+    int nodeCount; // Nodes including ground
+    int branchCount; // Extra branch unknowns
+    int n; // Matrix dimension
+    std::vector<Entry> entries; // Stamps since the last ClearMatrix()
+    std::vector<double> b; // Right-hand side
+    std::vector<double> x; // Solution of the last Solve()
+    bool factored; // Valid factors are held
+
+    // Sparse factors: the permuted matrix with fill, in compressed rows.
+    // Columns before the diagonal hold L (unit diagonal implied), the rest U.
+    bool analyzed; // Symbolic analysis matches the current pattern
+    std::vector<int> perm; // perm[k] = unknown eliminated k-th
+    std::vector<int> permInv; // permInv[unknown] = k
+    std::vector<int> rowStart; // Row k occupies [rowStart[k], rowStart[k+1])
+    std::vector<int> colIndex; // Permuted column of each stored value, ascending per row
+    std::vector<int> diagPos; // Position of the diagonal in each row
+    std::vector<double> values; // Factor values
+    std::vector<double> work; // Dense scratch row
+    size_t matrixNonZeros; // Distinct stamped positions
+    double factorFlops; // Multiply-adds per numeric factorization
+
+    // Dense fallback
+    bool dense; // Dense factors are in use
+    std::vector<double> A; // Row-major matrix, overwritten by its LU factors
+    std::vector<int> pivot; // Row permutation from FactorDense()
+
+    // Statistics
+    int analyzeCount; // Symbolic analyses performed
+    int factorCount; // Numeric factorizations performed
+
+    void Analyze(); // Ordering and fill pattern from entries
+    bool Assemble(); // Sum entries into values, false if one is outside the pattern
+    bool FactorSparse(); // Numeric phase, false on a zero pivot
+    bool FactorDense(); // Partial pivoting LU of the assembled entries
+
+public:
+    MnaSystem();
+
+    void Resize(int nodes, int branches); // Set dimensions and clear everything
+    int Size() const { return n; }
+    int NodeCount() const { return nodeCount; }
+
+    int NodeUnknown(int node) const { return node - 1; } // -1 for ground
+    int BranchUnknown(int branch) const { return nodeCount - 1 + branch; }
+
+    // Matrix stamps, ignoring ground rows and columns
+    void ClearMatrix(); // Drop all entries before restamping
+    void AddEntry(int row, int col, double value); // Raw unknown indices
+    void AddConductance(int a, int b, double g); // Conductance between two nodes
+    void ClearRhs(); // Zero b before each step
+    void AddRhs(int row, double value); // Raw unknown index
+    void AddCurrent(int a, int b, double current); // Element current flowing from node a to node b
+
+    bool Factor(); // LU of the stamped matrix, false if singular
+    bool IsFactored() const { return factored; }
+    void Solve(); // x = A^-1 b using the current factors
+
+    double NodeVoltage(int node) const { return node == 0 ? 0.0 : x[node - 1]; }
+    double Unknown(int index) const { return x[index]; }
+
+    // Cost figures for reports
+    bool IsDense() const { return dense; }
+    size_t MatrixNonZeros() const { return matrixNonZeros; } // Distinct entries of A
+    size_t FactorNonZeros() const { return dense ? size_t(n) * n : colIndex.size(); } // L + U including fill
+    double FactorFlops() const { return factorFlops; }
+    int AnalyzeCount() const { return analyzeCount; }
+    int FactorCount() const { return factorCount; }
+};
+
+#endif // _MNASYSTEMH
@@ -0,0 +1,268 @@
+// MonteCarlo.cpp - Tolerance analysis with online per-step statistics
+
+#define _USE_MATH_DEFINES
+#include "MonteCarlo.h"
+#include "AnalogCircuit.h" // Simulation core
+#include "ThreadPool.h" // Work-stealing pool
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+static const char* channelNames[MonteCarlo::channelCount] = { "R1", "C1", "L1" };
+static const double quantiles[] = { 0.01, 0.05, 0.5, 0.95, 0.99 };
+
+//------------------------------------------------------------------------------
+MonteCarlo::MonteCarlo(const Tolerance& R, const Tolerance& L, const Tolerance& C,
+    double frequency, double peakVoltage, double time, uint64_t randomSeed)
+    : freq(frequency), Vpeak(peakVoltage), simTime(time), seed(randomSeed), trials(0), steps(0),
+    peakLimit(0.0), withinLimit(0), workerBytes(0), workerCount(0) {
+    tolerances[0] = R;
+    tolerances[1] = L;
+    tolerances[2] = C;
+}
+
+//------------------------------------------------------------------------------
+// SplitMix64 finalizer over the counter: any (seed, trial, draw) can be
+// evaluated directly, in any order, on any thread
+double MonteCarlo::Uniform(uint64_t seed, uint64_t trial, uint64_t draw) {
+    auto mix = [](uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+    uint64_t x = mix(mix(seed + 0x9e3779b97f4a7c15ULL * (trial + 1)) ^ (0xd1b54a32d192ed03ULL * (draw + 1)));
+    return (x >> 11) * (1.0 / 9007199254740992.0); // 53 bits
+}
+
+//------------------------------------------------------------------------------
+// Two draws per element: uniform uses the first, normal both (Box-Muller)
+void MonteCarlo::Draw(size_t trial, double& R, double& L, double& C) const {
+    double values[3];
+    for (int e = 0; e < 3; ++e) {
+        const Tolerance& t = tolerances[e];
+        double u1 = Uniform(seed, trial, 2 * e), u2 = Uniform(seed, trial, 2 * e + 1);
+        double x = t.shape == TOL_NORMAL
+            ? sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2) / 3.0
+            : 2.0 * u1 - 1.0;
+        values[e] = t.nominal * (1.0 + t.spread * x);
+    }
+    R = values[0];
+    L = values[1];
+    C = values[2];
+}
+
+//------------------------------------------------------------------------------
+// Visits every step's vR, vC, vL (cell = step * channelCount + channel),
+// then the trial's peak |v| of each channel in the extra row
+template <class Visit>
+void MonteCarlo::Simulate(size_t trial, Visit&& visit) const {
+    double R, L, C;
+    Draw(trial, R, L, C);
+    AnalogCircuit circuit("", R, L, C, freq, Vpeak, simTime);
+    circuit.SetVerbose(false);
+    circuit.run();
+
+    double peak[channelCount] = { 0.0, 0.0, 0.0 };
+    for (size_t k = 0; k < steps && circuit.runStep(); ++k) {
+        const Sample& s = circuit.lastSample;
+        double v[channelCount] = { s.vR, s.vC, s.vL };
+        for (int ch = 0; ch < channelCount; ++ch) {
+            visit(k * channelCount + ch, v[ch]);
+            peak[ch] = max(peak[ch], fabs(v[ch]));
+        }
+    }
+    for (int ch = 0; ch < channelCount; ++ch) visit(steps * channelCount + ch, peak[ch]);
+}
+
+//------------------------------------------------------------------------------
+// Bins 1 .. binCount - 2 split the pilot range; 0 and binCount - 1 take
+// everything below and above it
+int MonteCarlo::Bin(size_t cell, double x) const {
+    double lo = rangeLo[cell], hi = rangeHi[cell];
+    if (x < lo) return 0;
+    if (x >= hi) return binCount - 1;
+    int b = 1 + static_cast<int>((x - lo) / (hi - lo) * (binCount - 2));
+    return min(b, binCount - 2);
+}
+
+//------------------------------------------------------------------------------
+// Linear interpolation inside the bin holding rank q * n; the edge bins
+// reach out to the exact min and max
+double MonteCarlo::Quantile(size_t cell, double q) const {
+    const uint32_t* counts = &histogram[cell * binCount];
+    const Moments& m = moments[cell];
+    double rank = q * trials, seen = 0.0;
+    double width = (rangeHi[cell] - rangeLo[cell]) / (binCount - 2);
+    for (int b = 0; b < binCount; ++b) {
+        if (counts[b] == 0 || seen + counts[b] < rank) {
+            seen += counts[b];
+            continue;
+        }
+        double from = b == 0 ? m.lo : b == binCount - 1 ? rangeHi[cell] : rangeLo[cell] + (b - 1) * width;
+        double to = b == 0 ? rangeLo[cell] : b == binCount - 1 ? m.hi : from + width;
+        double x = from + (to - from) * (rank - seen) / counts[b];
+        return min(m.hi, max(m.lo, x));
+    }
+    return m.hi;
+}
+
+//------------------------------------------------------------------------------
+bool MonteCarlo::Run(size_t trialCount, unsigned threads) {
+    if (trialCount == 0) return false;
+
+    // Nominal run: the time grid every trial shares (fixed step, same stop time)
+    {
+        AnalogCircuit nominal("", tolerances[0].nominal, tolerances[1].nominal, tolerances[2].nominal,
+            freq, Vpeak, simTime);
+        nominal.SetVerbose(false);
+        nominal.run();
+        times.clear();
+        while (nominal.runStep()) times.push_back(nominal.lastSample.time);
+        steps = times.size();
+    }
+    size_t cells = (steps + 1) * channelCount;
+
+    // Pilot: histogram ranges from the first trials
+    rangeLo.assign(cells, HUGE_VAL);
+    rangeHi.assign(cells, -HUGE_VAL);
+    for (size_t trial = 0; trial < min(trialCount, pilotTrials); ++trial) {
+        Simulate(trial, [&](size_t cell, double x) {
+            rangeLo[cell] = min(rangeLo[cell], x);
+            rangeHi[cell] = max(rangeHi[cell], x);
+        });
+    }
+    for (size_t cell = 0; cell < cells; ++cell) {
+        double span = rangeHi[cell] - rangeLo[cell];
+        double pad = span > 0.0 ? 0.25 * span : max(1e-12, 1e-9 * fabs(rangeHi[cell]));
+        rangeLo[cell] -= pad;
+        rangeHi[cell] += pad;
+    }
+
+    trials = trialCount;
+    moments.assign(cells, Moments{ 0.0, 0.0, HUGE_VAL, -HUGE_VAL });
+    histogram.assign(cells * binCount, 0);
+    withinLimit = 0;
+
+    ThreadPool pool(threads);
+    workerCount = pool.size();
+    workerBytes = cells * (sizeof(Moments) + binCount * sizeof(uint32_t));
+    size_t blocks = (trialCount + blockTrials - 1) / blockTrials;
+    atomic<size_t> nextBlock(0);
+    size_t merged = 0; // Blocks folded into moments, guarded by mergeLock
+    mutex mergeLock;
+    condition_variable turn;
+
+    // Workers claim blocks in increasing order, so the block a worker waits
+    // for is always held by a running worker
+    for (unsigned w = 0; w < workerCount; ++w) {
+        pool.submit([&, cells] {
+            vector<Moments> block(cells);
+            vector<uint32_t> counts(cells * binCount, 0);
+            size_t within = 0;
+            const size_t peakVC = steps * channelCount + 1;
+            for (size_t b = nextBlock++; b < blocks; b = nextBlock++) {
+                size_t first = b * blockTrials, last = min(trialCount, first + blockTrials);
+                fill(block.begin(), block.end(), Moments{ 0.0, 0.0, HUGE_VAL, -HUGE_VAL });
+                for (size_t trial = first; trial < last; ++trial) {
+                    double n = double(trial - first + 1);
+                    Simulate(trial, [&](size_t cell, double x) {
+                        Moments& m = block[cell];
+                        double d = x - m.mean;
+                        m.mean += d / n;
+                        m.m2 += d * (x - m.mean);
+                        m.lo = min(m.lo, x);
+                        m.hi = max(m.hi, x);
+                        counts[cell * binCount + Bin(cell, x)]++;
+                        if (cell == peakVC && peakLimit > 0.0 && x <= peakLimit) within++;
+                    });
+                }
+
+                // Chan et al. pairwise merge, in block order
+                unique_lock<mutex> lock(mergeLock);
+                turn.wait(lock, [&] { return merged == b; });
+                double nA = double(first), nB = double(last - first), n = nA + nB;
+                for (size_t cell = 0; cell < cells; ++cell) {
+                    Moments& A = moments[cell];
+                    const Moments& B = block[cell];
+                    double delta = B.mean - A.mean;
+                    A.mean += delta * nB / n;
+                    A.m2 += B.m2 + delta * delta * nA * nB / n;
+                    A.lo = min(A.lo, B.lo);
+                    A.hi = max(A.hi, B.hi);
+                }
+                merged++;
+                turn.notify_all();
+            }
+
+            // Counts add up the same in any order
+            lock_guard<mutex> lock(mergeLock);
+            for (size_t i = 0; i < counts.size(); ++i) histogram[i] += counts[i];
+            withinLimit += within;
+        });
+    }
+    pool.wait();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool MonteCarlo::WriteRows(ostream& out, int channel, bool peaks) const {
+    size_t first = peaks ? steps : 0, last = peaks ? steps + 1 : steps;
+    for (size_t k = first; k < last; ++k) {
+        size_t cell = k * channelCount + channel;
+        const Moments& m = moments[cell];
+        double sd = trials > 1 ? sqrt(max(0.0, m.m2) / (trials - 1)) : 0.0;
+        if (peaks) out << setw(12) << channelNames[channel];
+        else out << setw(12) << times[k];
+        out << setw(12) << m.mean << setw(12) << sd << setw(12) << m.lo << setw(12) << m.hi;
+        for (double q : quantiles) out << setw(12) << Quantile(cell, q);
+        out << '\n';
+    }
+    return bool(out);
+}
+
+//------------------------------------------------------------------------------
+bool MonteCarlo::WriteEnvelopes(const string& prefix) const {
+    for (int ch = 0; ch < channelCount; ++ch) {
+        string filename = prefix + channelNames[ch] + ".dat";
+        ofstream out(filename);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open output file " << filename << endl;
+            return false;
+        }
+        out << setw(12) << "Time" << setw(12) << "Mean" << setw(12) << "StdDev" << setw(12) << "Min"
+            << setw(12) << "Max" << setw(12) << "P1" << setw(12) << "P5" << setw(12) << "P50"
+            << setw(12) << "P95" << setw(12) << "P99" << '\n';
+        if (!WriteRows(out, ch, false)) return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MonteCarlo::WriteSummary(ostream& out) const {
+    out << "Peak |v| over " << trials << " trials:" << '\n';
+    out << setw(12) << "Element" << setw(12) << "Mean" << setw(12) << "StdDev" << setw(12) << "Min"
+        << setw(12) << "Max" << setw(12) << "P1" << setw(12) << "P5" << setw(12) << "P50"
+        << setw(12) << "P95" << setw(12) << "P99" << '\n';
+    for (int ch = 0; ch < channelCount; ++ch) WriteRows(out, ch, true);
+    if (peakLimit > 0.0) {
+        out << "Yield (peak |vC| <= " << peakLimit << " V): " << withinLimit << " / " << trials
+            << " = " << 100.0 * Yield() << " %" << '\n';
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t MonteCarlo::MemoryBytes() const {
+    size_t shared = moments.capacity() * sizeof(Moments) + (rangeLo.capacity() + rangeHi.capacity()) * sizeof(double)
+        + histogram.capacity() * sizeof(uint32_t) + times.capacity() * sizeof(double);
+    return shared + workerCount * workerBytes;
+}
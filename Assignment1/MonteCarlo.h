@@ -0,0 +1,96 @@
+#ifndef _MONTECARLOH
+#define _MONTECARLOH
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Shape of a component tolerance
+enum ToleranceShape {
+    TOL_UNIFORM, // Anywhere in nominal * (1 +- spread)
+    TOL_NORMAL   // Gaussian with 3 sigma = nominal * spread
+};
+
+// Distribution of one element value
+struct Tolerance {
+    double nominal; // Nominal value
+    double spread; // Relative tolerance, 0.05 = 5%
+    ToleranceShape shape;
+};
+
+// Monte Carlo tolerance analysis of the series RLC circuit. Every trial draws
+// R, L and C, runs the fixed-step transient and is folded into per-time-step
+// statistics of vR, vC and vL as it runs; no trace is kept, so memory depends
+// on the number of time steps and threads, never on the number of trials.
+//
+// Reproducibility: the random values of trial k are a hash of (seed, k, draw)
+// rather than the next output of a per-thread generator, so each trial sees
+// the same values whichever thread runs it. Trials are grouped in fixed
+// blocks; each block's moments are computed in trial order and the blocks
+// are merged in block order, and the histogram and min/max updates are
+// order-free. The results are bit-identical for any thread count.
+//
+// Quantiles come from a histogram per time step and channel whose range is
+// set by a pilot (the first trials, run once beforehand) and widened by a
+// quarter of its span each side; values outside fall into edge bins that end
+// at the exact min and max, so extreme quantiles stay conservative.
+class MonteCarlo {
+public:
+    static const int channelCount = 3; // vR, vC, vL
+    static const int binCount = 32; // Histogram bins per time step and channel
+    static const size_t blockTrials = 64; // Trials per merge block
+    static const size_t pilotTrials = 256; // Trials that set the histogram ranges
+
+private:
+    // Running moments of one cell (time step and channel)
+    struct Moments {
+        double mean, m2; // Welford mean and sum of squared deviations
+        double lo, hi; // Smallest and largest value
+    };
+
+    Tolerance tolerances[3]; // R, L, C
+    double freq, Vpeak, simTime; // Source and run length
+    uint64_t seed; // Random stream key
+    size_t trials; // Trials folded in
+    size_t steps; // Time steps per trial (from the pilot)
+    std::vector<double> times; // Time of each step
+    std::vector<Moments> moments; // Merged moments, (steps + 1) * channelCount cells; the last row is per-trial peaks of |v|
+    std::vector<double> rangeLo, rangeHi; // Histogram range per cell
+    std::vector<uint32_t> histogram; // binCount counts per cell
+    double peakLimit; // Yield limit on the peak |vC|, 0 = none
+    size_t withinLimit; // Trials whose peak |vC| stayed within peakLimit
+    size_t workerBytes; // Scratch held by each worker while running
+    unsigned workerCount; // Threads used by the last Run()
+
+    // Run trial k, calling visit(cell, value) for every step and channel and the peaks
+    template <class Visit>
+    void Simulate(size_t trial, Visit&& visit) const;
+    int Bin(size_t cell, double x) const; // Histogram bin of a value
+    double Quantile(size_t cell, double q) const; // Approximate quantile from the histogram
+    bool WriteRows(std::ostream& out, int channel, bool peaks) const;
+
+public:
+    MonteCarlo(const Tolerance& R, const Tolerance& L, const Tolerance& C,
+        double frequency, double peakVoltage, double time, uint64_t randomSeed);
+
+    // Counter-based generator: uniform in [0, 1) from (seed, trial, draw)
+    static double Uniform(uint64_t seed, uint64_t trial, uint64_t draw);
+    void Draw(size_t trial, double& R, double& L, double& C) const; // Element values of one trial
+
+    void SetPeakLimit(double volts) { peakLimit = volts; } // Count trials with peak |vC| <= volts
+    bool Run(size_t trialCount, unsigned threads); // Pilot, then every trial on 'threads' workers
+
+    // One file per component, prefix + "R1.dat" etc.: time, mean, standard
+    // deviation, min, max and the 1/5/50/95/99 % quantiles per step
+    bool WriteEnvelopes(const std::string& prefix) const;
+    void WriteSummary(std::ostream& out) const; // Peak |v| statistics and yield
+
+    size_t Trials() const { return trials; }
+    size_t Steps() const { return steps; }
+    double Yield() const { return trials ? double(withinLimit) / trials : 0.0; }
+    size_t MemoryBytes() const; // Statistics plus the per-worker scratch
+};
+
+#endif // _MONTECARLOH
@@ -0,0 +1,129 @@
+// ParameterSweep.cpp - Multi-core parameter sweeps of the series RLC circuit
+
+#include "ParameterSweep.h"
+#include "AnalogCircuit.h" // Simulation core
+#include "ThreadPool.h" // Work-stealing pool
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// Expand the parameter lists into their cartesian product
+ParameterSweep::ParameterSweep(const vector<double>& R, const vector<double>& L,
+    const vector<double>& C, const vector<double>& frequency,
+    const vector<double>& peakVoltage, double time, double band)
+    : Rs(R), Ls(L), Cs(C), freqs(frequency), Vpeaks(peakVoltage), simTime(time), settleBand(band) {
+    for (double r : Rs)
+        for (double l : Ls)
+            for (double c : Cs)
+                for (double f : freqs)
+                    for (double v : Vpeaks)
+                        configs.push_back(SweepConfig{ r, l, c, f, v });
+    results.resize(configs.size());
+}
+
+//------------------------------------------------------------------------------
+// Parse a single value, a comma list or an inclusive start:stop:step range
+bool ParameterSweep::ParseRange(const string& text, vector<double>& values) {
+    values.clear();
+    if (text.find(':') != string::npos) {
+        double start, stop, step;
+        char c1, c2;
+        istringstream in(text);
+        if (!(in >> start >> c1 >> stop >> c2 >> step) || c1 != ':' || c2 != ':' || step <= 0.0 || stop < start)
+            return false;
+        // Count from the start so rounding does not drop the last point
+        int n = static_cast<int>(floor((stop - start) / step + 1e-9)) + 1;
+        for (int i = 0; i < n; ++i) values.push_back(start + i * step);
+        return true;
+    }
+
+    istringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        double v;
+        if (!(istringstream(item) >> v)) return false;
+        values.push_back(v);
+    }
+    return !values.empty();
+}
+
+//------------------------------------------------------------------------------
+// Run one configuration to completion and reduce it to summary values
+SweepResult ParameterSweep::Simulate(const SweepConfig& config, double simTime, double band,
+    const string& traceFile) {
+    AnalogCircuit circuit(traceFile, config.R, config.L, config.C, config.freq, config.Vpeak, simTime);
+    circuit.SetVerbose(false);
+    SweepResult result = Simulate(circuit, band);
+    circuit.CloseOutput(); // Reports a trace that could not be written
+    return result;
+}
+
+//------------------------------------------------------------------------------
+SweepResult ParameterSweep::Simulate(AnalogCircuit& circuit, double band) {
+    circuit.run();
+
+    SweepResult result{ 0.0, 0.0, -1.0, 0 };
+    double cutoff = 0.6 * circuit.timeMax; // Source switches off here (see runStep)
+    double lastOutside = cutoff; // Last time |vC| was outside the settling band
+    vector<double> tailTime, tailVC; // Decay after cutoff, checked once peak is known
+
+    while (circuit.runStep()) {
+        const Sample& s = circuit.lastSample;
+        result.peakVC = max(result.peakVC, fabs(s.vC));
+        result.peakI = max(result.peakI, fabs(s.current));
+        if (s.time >= cutoff) {
+            tailTime.push_back(s.time);
+            tailVC.push_back(s.vC);
+        }
+    }
+    result.steps = circuit.stepCount;
+
+    double limit = band * result.peakVC;
+    for (size_t i = 0; i < tailTime.size(); ++i) {
+        if (fabs(tailVC[i]) > limit) lastOutside = tailTime[i];
+    }
+    // Still outside the band at the last sample means it never settled
+    if (tailTime.empty() || fabs(tailVC.back()) <= limit) result.settleTime = lastOutside - cutoff;
+    return result;
+}
+
+//------------------------------------------------------------------------------
+// Simulate every configuration on the thread pool
+void ParameterSweep::Run(unsigned threads, const string& tracePrefix) {
+    ThreadPool pool(threads);
+    for (size_t i = 0; i < configs.size(); ++i) {
+        pool.submit([this, i, &tracePrefix] {
+            string trace = tracePrefix.empty() ? string() : tracePrefix + to_string(i) + ".dat";
+            results[i] = Simulate(configs[i], simTime, settleBand, trace);
+        });
+    }
+    pool.wait();
+}
+
+//------------------------------------------------------------------------------
+// Write one row per configuration in the same fixed-width layout as RLC.dat
+void ParameterSweep::WriteSummary(const string& filename) const {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open output file " << filename << endl;
+        exit(1);
+    }
+
+    out << setw(8) << "Index" << setw(12) << "R" << setw(12) << "L" << setw(12) << "C"
+        << setw(12) << "Freq" << setw(12) << "Vpeak" << setw(12) << "PeakVC"
+        << setw(12) << "PeakI" << setw(12) << "Settle" << '\n';
+    for (size_t i = 0; i < configs.size(); ++i) {
+        const SweepConfig& c = configs[i];
+        const SweepResult& r = results[i];
+        out << setw(8) << i << setw(12) << c.R << setw(12) << c.L << setw(12) << c.C
+            << setw(12) << c.freq << setw(12) << c.Vpeak << setw(12) << r.peakVC
+            << setw(12) << r.peakI << setw(12) << r.settleTime << '\n';
+    }
+}
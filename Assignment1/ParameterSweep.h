@@ -0,0 +1,55 @@
+#ifndef _PARAMETERSWEEPH
+#define _PARAMETERSWEEPH
+
+#include <string>
+#include <vector>
+
+class AnalogCircuit;
+
+// One circuit configuration in a sweep
+struct SweepConfig {
+    double R; // Resistance (ohms)
+    double L; // Inductance (henries)
+    double C; // Capacitance (farads)
+    double freq; // Source frequency (Hz)
+    double Vpeak; // Source peak voltage (V)
+};
+
+// Summary of one simulated configuration
+struct SweepResult {
+    double peakVC; // Largest |vC| over the run (V)
+    double peakI; // Largest |I| over the run (A)
+    double settleTime; // Time after source cutoff until |vC| stays within the band, -1 if never
+    int steps; // Time steps simulated
+};
+
+// Cartesian-product sweep over R, L, C, frequency and amplitude.
+// Every configuration is an independent AnalogCircuit run on the work-stealing
+// thread pool; results are written in configuration order.
+class ParameterSweep {
+    std::vector<double> Rs, Ls, Cs, freqs, Vpeaks; // Values for each parameter
+    double simTime; // Simulated time per configuration (s)
+    double settleBand; // Settling band as a fraction of peak |vC|
+    std::vector<SweepConfig> configs; // Expanded configurations
+    std::vector<SweepResult> results; // One per configuration
+
+public:
+    ParameterSweep(const std::vector<double>& R, const std::vector<double>& L,
+        const std::vector<double>& C, const std::vector<double>& frequency,
+        const std::vector<double>& peakVoltage, double simTime, double band = 0.02);
+
+    // Parse "v", "v1,v2,..." or "start:stop:step" into values, false on bad input
+    static bool ParseRange(const std::string& text, std::vector<double>& values);
+
+    // Simulate a single configuration, optionally writing its full trace
+    static SweepResult Simulate(const SweepConfig& config, double simTime, double band,
+        const std::string& traceFile);
+    // Run an already configured circuit to completion and reduce it the same way
+    static SweepResult Simulate(AnalogCircuit& circuit, double band);
+
+    void Run(unsigned threads, const std::string& tracePrefix); // Simulate every configuration
+    void WriteSummary(const std::string& filename) const; // One row per configuration
+    size_t Count() const { return configs.size(); } // Number of configurations
+};
+
+#endif // _PARAMETERSWEEPH
@@ -0,0 +1,227 @@
+// PartitionedTransient.cpp - Multi-threaded ladder transient (Schur complement on interface nodes)
+
+#include "PartitionedTransient.h"
+#include "TraceWriter.h" // Buffered background file output
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// Reusable barrier for threads stepping in lockstep. A step of a 10k-section
+// ladder takes tens of microseconds, too short to sleep on a condition
+// variable at every phase, so arrivals spin on the generation counter for a
+// while and only then start yielding the core.
+class SpinBarrier {
+    const unsigned count; // Threads that must arrive
+    atomic<unsigned> waiting; // Arrived in this generation
+    atomic<unsigned> generation; // Bumped by the last arrival
+
+public:
+    explicit SpinBarrier(unsigned threads) : count(threads), waiting(0), generation(0) {}
+
+    void Wait() {
+        unsigned gen = generation.load(memory_order_acquire);
+        if (waiting.fetch_add(1, memory_order_acq_rel) + 1 == count) {
+            waiting.store(0, memory_order_relaxed);
+            generation.fetch_add(1, memory_order_release);
+            return;
+        }
+        for (int spin = 0; generation.load(memory_order_acquire) == gen; ++spin)
+            if (spin >= 2000) this_thread::yield();
+    }
+};
+
+//------------------------------------------------------------------------------
+// Node k (1..N) is the far end of section k; g, gLh and cap are indexed the
+// same way, with a zero section N + 1 so the last row needs no special case.
+// Backward Euler for section k: i_k = g_k (v_{k-1} - v_k) + gLh_k i_k(old).
+PartitionedTransient::PartitionedTransient(const LadderNetwork& network, double step, size_t partitions)
+    : net(network), h(step), N(network.Sections()), seconds(0.0), steps(0) {
+    parts = max<size_t>(1, min(partitions, (N + 1) / 2));
+
+    g.assign(N + 2, 0.0);
+    gLh.assign(N + 2, 0.0);
+    cap.assign(N + 2, 0.0);
+    for (size_t k = 1; k <= N; ++k) {
+        g[k] = 1.0 / (net.R[k - 1] + net.L[k - 1] / h);
+        gLh[k] = g[k] * net.L[k - 1] / h;
+        cap[k] = net.C[k - 1] / h;
+    }
+    a.assign(N + 2, 0.0);
+    d.assign(N + 2, 0.0);
+    c.assign(N + 2, 0.0);
+    for (size_t k = 1; k <= N; ++k) {
+        a[k] = -g[k];
+        c[k] = -g[k + 1];
+        d[k] = cap[k] + g[k] + g[k + 1];
+    }
+    if (N > 0 && net.load > 0.0) d[N] += 1.0 / net.load;
+
+    // Interiors as even as possible, one interface node after each but the last
+    lo.resize(parts);
+    hi.resize(parts);
+    size_t interior = N - (parts - 1), start = 1;
+    for (size_t p = 0; p < parts; ++p) {
+        size_t size = interior / parts + (p < interior % parts ? 1 : 0);
+        lo[p] = start;
+        hi[p] = start + size - 1;
+        start = hi[p] + 2;
+    }
+
+    // Interior factors, then the responses to each interface voltage
+    cp.assign(N + 2, 0.0);
+    inv.assign(N + 2, 0.0);
+    spikeL.assign(N + 2, 0.0);
+    spikeR.assign(N + 2, 0.0);
+    for (size_t p = 0; p < parts; ++p) {
+        for (size_t k = lo[p]; k <= hi[p]; ++k) {
+            inv[k] = 1.0 / (d[k] - (k > lo[p] ? a[k] * cp[k - 1] : 0.0));
+            cp[k] = c[k] * inv[k];
+        }
+        if (p > 0) {
+            spikeL[lo[p]] = a[lo[p]];
+            SolveInterior(p, spikeL.data());
+        }
+        if (p + 1 < parts) {
+            spikeR[hi[p]] = c[hi[p]];
+            SolveInterior(p, spikeR.data());
+        }
+    }
+
+    // Interface s sits between partitions s and s + 1
+    size_t interfaces = parts - 1;
+    sepLower.assign(interfaces, 0.0);
+    sepUpper.assign(interfaces, 0.0);
+    sepCp.assign(interfaces, 0.0);
+    sepInv.assign(interfaces, 0.0);
+    sepRhs.assign(interfaces, 0.0);
+    for (size_t s = 0; s < interfaces; ++s) {
+        size_t q = hi[s] + 1, left = hi[s], right = lo[s + 1];
+        sepLower[s] = -a[q] * spikeL[left];
+        sepUpper[s] = -c[q] * spikeR[right];
+        double diag = d[q] - a[q] * spikeR[left] - c[q] * spikeL[right];
+        sepInv[s] = 1.0 / (diag - (s > 0 ? sepLower[s] * sepCp[s - 1] : 0.0));
+        sepCp[s] = sepUpper[s] * sepInv[s];
+    }
+
+    v.assign(N + 2, 0.0);
+    i.assign(N + 2, 0.0);
+    z.assign(N + 2, 0.0);
+}
+
+//------------------------------------------------------------------------------
+void PartitionedTransient::SolveInterior(size_t p, double* x) const {
+    size_t first = lo[p], last = hi[p];
+    x[first] *= inv[first];
+    for (size_t k = first + 1; k <= last; ++k)
+        x[k] = (x[k] - a[k] * x[k - 1]) * inv[k];
+    for (size_t k = last; k-- > first;)
+        x[k] -= cp[k] * x[k + 1];
+}
+
+//------------------------------------------------------------------------------
+// Reads only the partition's own nodes and sections (lo..hi + 1), so it may
+// overlap with a neighbour still finishing Correct() of the previous step
+void PartitionedTransient::StepInterior(size_t p, double t) {
+    for (size_t k = lo[p]; k <= hi[p]; ++k)
+        z[k] = cap[k] * v[k] + gLh[k] * i[k] - gLh[k + 1] * i[k + 1];
+    if (p == 0) z[1] += g[1] * net.SourceVoltage(t);
+    SolveInterior(p, z.data());
+}
+
+//------------------------------------------------------------------------------
+void PartitionedTransient::SolveInterfaces() {
+    size_t interfaces = parts - 1;
+    for (size_t s = 0; s < interfaces; ++s) {
+        size_t q = hi[s] + 1;
+        double r = cap[q] * v[q] + gLh[q] * i[q] - gLh[q + 1] * i[q + 1]
+            - a[q] * z[hi[s]] - c[q] * z[lo[s + 1]];
+        sepRhs[s] = (r - (s > 0 ? sepLower[s] * sepRhs[s - 1] : 0.0)) * sepInv[s];
+    }
+    for (size_t s = interfaces; s-- > 0;) {
+        if (s + 1 < interfaces) sepRhs[s] -= sepCp[s] * sepRhs[s + 1];
+        v[hi[s] + 1] = sepRhs[s];
+    }
+}
+
+//------------------------------------------------------------------------------
+void PartitionedTransient::Correct(size_t p, double t) {
+    double vLeft = p > 0 ? v[lo[p] - 1] : 0.0;
+    double vRight = p + 1 < parts ? v[hi[p] + 1] : 0.0;
+    for (size_t k = lo[p]; k <= hi[p]; ++k)
+        v[k] = z[k] - spikeL[k] * vLeft - spikeR[k] * vRight;
+    if (p == 0) v[0] = net.SourceVoltage(t);
+
+    // Sections lo..hi + 1 belong to this partition; the last one ends at node N
+    size_t last = p + 1 < parts ? hi[p] + 1 : hi[p];
+    for (size_t k = lo[p]; k <= last; ++k)
+        i[k] = g[k] * (v[k - 1] - v[k]) + gLh[k] * i[k];
+}
+
+//------------------------------------------------------------------------------
+// Thread 0 (the caller) takes partition 0 and phase B, and writes the
+// previous step's row while the others wait for the interface voltages;
+// phase A leaves v untouched, so the row still holds that step's values.
+bool PartitionedTransient::Run(double stopTime, const string& filename, const vector<size_t>& probes) {
+    for (size_t node : probes) {
+        if (node > N) {
+            cerr << "Error: node " << node << " is beyond the end of the ladder (" << N << ")" << endl;
+            return false;
+        }
+    }
+    fill(v.begin(), v.end(), 0.0);
+    fill(i.begin(), i.end(), 0.0);
+
+    vector<double> times; // Same clock as MnaCircuit
+    for (double t = 0.0; t < stopTime; t += h) times.push_back(t);
+
+    TraceWriter fout;
+    if (!filename.empty()) {
+        if (!fout.Open(filename)) {
+            cerr << "Error: Could not open output file " << filename << endl;
+            return false;
+        }
+        vector<string> names{ "Time" };
+        for (size_t node : probes) names.push_back("V(n" + to_string(node) + ")");
+        fout.WriteHeader(names);
+    }
+    vector<double> row(probes.size() + 1);
+    auto writeRow = [&](double t) {
+        if (!fout.IsOpen()) return;
+        row[0] = t;
+        for (size_t j = 0; j < probes.size(); ++j) row[j + 1] = v[probes[j]];
+        fout.WriteRow(row.data(), static_cast<int>(row.size()));
+    };
+
+    auto begin = chrono::steady_clock::now();
+    SpinBarrier barrier(static_cast<unsigned>(parts));
+    auto worker = [&](size_t p) {
+        for (size_t n = 0; n < times.size(); ++n) {
+            StepInterior(p, times[n]);
+            barrier.Wait();
+            if (p == 0) {
+                if (n > 0) writeRow(times[n - 1]);
+                SolveInterfaces();
+            }
+            barrier.Wait();
+            Correct(p, times[n]);
+        }
+    };
+    vector<thread> threads;
+    for (size_t p = 1; p < parts; ++p) threads.emplace_back(worker, p);
+    worker(0);
+    for (auto& t : threads) t.join();
+    if (!times.empty()) writeRow(times.back());
+    if (!fout.Close()) {
+        cerr << "Error: Could not write output file " << filename << endl;
+        return false;
+    }
+
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    steps = times.size();
+    return true;
+}
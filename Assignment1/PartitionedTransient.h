@@ -0,0 +1,58 @@
+#ifndef _PARTITIONEDTRANSIENTH
+#define _PARTITIONEDTRANSIENTH
+
+#include "LadderNetwork.h"
+
+#include <string>
+#include <vector>
+
+// Backward Euler transient of a LadderNetwork, split across threads. With the
+// series R-L of each section eliminated, every step is one tridiagonal solve
+// for the node voltages. The chain is cut into P partitions: contiguous runs
+// of nodes, one per thread, separated by single interface nodes. Each step
+//   A (parallel) every thread solves its own run with the interfaces held at
+//     zero, using factors computed once;
+//   B (thread 0) the interface voltages follow from a small (P-1) tridiagonal
+//     Schur complement system, also factored once;
+//   C (parallel) every thread corrects its run with the precomputed responses
+//     to the two interface voltages and updates its section currents.
+// The threads meet at a spinning barrier after A and after B. The result is
+// the direct solution of the whole system (no relaxation sweeps), equal to the
+// single-partition run up to rounding, and follows the conventions of
+// MnaCircuit: the source is evaluated at the start of each step and the row is
+// stamped with that time.
+class PartitionedTransient {
+    const LadderNetwork& net;
+    double h; // Time step
+    size_t N; // Sections = unknown node voltages
+    size_t parts; // Partitions = threads
+    std::vector<size_t> lo, hi; // Interior nodes of each partition; the interface is hi + 1
+    std::vector<double> g, gLh, cap; // Section conductance 1/(R + L/h), its history factor and C/h, by node
+    std::vector<double> a, d, c; // Tridiagonal: a[k] couples v[k-1], d[k] is the diagonal, c[k] couples v[k+1]
+    std::vector<double> cp, inv; // Forward elimination factors of each interior
+    std::vector<double> spikeL, spikeR; // Interior response to unit left / right interface voltage
+    std::vector<double> sepLower, sepUpper, sepCp, sepInv; // Factored interface system
+    std::vector<double> v, i, z, sepRhs; // Node voltages, section currents, interior solution, interface right-hand side
+    double seconds; // Wall time of the last Run()
+    size_t steps; // Steps taken by the last Run()
+
+    void SolveInterior(size_t p, double* x) const; // In place, interfaces held at zero
+    void StepInterior(size_t p, double t); // Phase A
+    void SolveInterfaces(); // Phase B
+    void Correct(size_t p, double t); // Phase C
+
+public:
+    // partitions is clamped so that every interior keeps at least one node
+    PartitionedTransient(const LadderNetwork& network, double step, size_t partitions);
+
+    // Integrate from rest to stopTime, writing Time and V() of the probe nodes
+    // (0 = the source node) to filename; empty = no file
+    bool Run(double stopTime, const std::string& filename, const std::vector<size_t>& probes);
+
+    size_t Partitions() const { return parts; }
+    double Seconds() const { return seconds; }
+    size_t Steps() const { return steps; }
+    double NodeVoltage(size_t node) const { return v[node]; } // After Run()
+};
+
+#endif // _PARTITIONEDTRANSIENTH
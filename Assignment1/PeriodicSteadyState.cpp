@@ -0,0 +1,76 @@
+// PeriodicSteadyState.cpp - Shooting method for the sinusoidal steady state
+
+#include "PeriodicSteadyState.h"
+#include "AnalogCircuit.h" // Simulation core
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+PeriodicSteadyState::PeriodicSteadyState(AnalogCircuit& c, double nominalStep)
+    : circuit(c), iterations(0), integrations(0), residual(0.0) {
+    period = 1.0 / circuit.GetFrequency();
+    stepsPerPeriod = max(1, static_cast<int>(ceil(period / nominalStep - 1e-9)));
+    state[0] = state[1] = 0.0;
+
+    circuit.SetTimeStep(period / stepsPerPeriod);
+    circuit.SetSourceCutoff(HUGE_VAL);
+    circuit.timeMax = HUGE_VAL; // runStep() stops only when told
+}
+
+//------------------------------------------------------------------------------
+void PeriodicSteadyState::Integrate(const double x0[2], double x1[2]) {
+    circuit.Reset(x0[0], x0[1]);
+    for (int k = 0; k < stepsPerPeriod; ++k) circuit.runStep();
+    circuit.GetState(x1[0], x1[1]);
+    integrations++;
+}
+
+//------------------------------------------------------------------------------
+// Newton on G(x) = F(x) - x. Each column of dF/dx comes from one integration
+// with that state perturbed; the 2x2 update is solved by Cramer's rule.
+bool PeriodicSteadyState::Solve(double tolerance, int maxIterations) {
+    circuit.SetRecording(false);
+    iterations = 0;
+    integrations = 0;
+    double x[2] = { 0.0, 0.0 }, Fx[2];
+    Integrate(x, Fx);
+
+    bool converged = false;
+    for (;;) {
+        double G[2] = { Fx[0] - x[0], Fx[1] - x[1] };
+        double scale[2] = { fabs(x[0]) + fabs(Fx[0]), fabs(x[1]) + fabs(Fx[1]) };
+        residual = max(fabs(G[0]) / max(scale[0], 1e-12), fabs(G[1]) / max(scale[1], 1e-12));
+        if (residual <= tolerance) { converged = true; break; }
+        if (iterations >= maxIterations) break;
+        iterations++;
+
+        double J[2][2];
+        for (int j = 0; j < 2; ++j) {
+            double xp[2] = { x[0], x[1] }, Fp[2];
+            double h = 1e-6 * max(scale[j], 1e-6);
+            xp[j] += h;
+            Integrate(xp, Fp);
+            for (int i = 0; i < 2; ++i) J[i][j] = (Fp[i] - Fx[i]) / h - (i == j ? 1.0 : 0.0);
+        }
+        double det = J[0][0] * J[1][1] - J[0][1] * J[1][0];
+        if (det == 0.0) break;
+        x[0] -= (G[0] * J[1][1] - G[1] * J[0][1]) / det;
+        x[1] -= (G[1] * J[0][0] - G[0] * J[1][0]) / det;
+        Integrate(x, Fx);
+    }
+
+    state[0] = x[0];
+    state[1] = x[1];
+    circuit.SetRecording(true);
+    return converged;
+}
+
+//------------------------------------------------------------------------------
+void PeriodicSteadyState::EmitPeriod() {
+    circuit.SetRecording(true);
+    circuit.Reset(state[0], state[1]);
+    for (int k = 0; k < stepsPerPeriod; ++k) circuit.runStep();
+}
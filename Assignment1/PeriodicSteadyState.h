@@ -0,0 +1,38 @@
+#ifndef _PERIODICSTEADYSTATEH
+#define _PERIODICSTEADYSTATEH
+
+class AnalogCircuit;
+
+// Periodic steady state of the series circuit under its sine drive, by the
+// shooting method. The state x = (vC, iL) is integrated over one source
+// period with the circuit's own solver, giving x(P) = F(x0). Newton on
+// F(x0) - x0 = 0, with the 2x2 Jacobian dF/dx0 from perturbed integrations,
+// finds the state that reproduces itself. For a linear circuit F is affine
+// and one Newton step lands on the answer, whatever the damping; otherwise it
+// converges quadratically once close.
+//
+// The solver takes over the circuit's clock: the source never switches off,
+// the step is period / stepsPerPeriod and every integration starts at t = 0.
+class PeriodicSteadyState {
+    AnalogCircuit& circuit; // Circuit being solved, not owned
+    double period; // Source period (s)
+    int stepsPerPeriod; // Fixed steps in one period
+
+    void Integrate(const double x0[2], double x1[2]); // One period from x0
+
+public:
+    int iterations; // Newton iterations taken by the last Solve()
+    int integrations; // Single-period integrations by the last Solve()
+    double residual; // max |F(x0) - x0| relative to the state size at the end
+    double state[2]; // Steady-state (vC, iL) at the start of the period
+
+    // Steps are the nominal step rounded so that a whole number fits in a period
+    PeriodicSteadyState(AnalogCircuit& circuit, double nominalStep);
+
+    bool Solve(double tolerance = 1e-9, int maxIterations = 20); // Start at x0 = 0
+    void EmitPeriod(); // Integrate one steady-state period with data file output on
+    double Period() const { return period; }
+    int StepsPerPeriod() const { return stepsPerPeriod; }
+};
+
+#endif // _PERIODICSTEADYSTATEH
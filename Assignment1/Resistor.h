@@ -4,7 +4,7 @@
 
 
 // Resistor class derived from Component
-class Resistor : public Component {
+class Resistor final : public Component {
 	double resistance; //Resistance in ohms
 public:
 	//Constructor to initialize resistance and color
@@ -18,6 +18,17 @@ public:
         return I * resistance;  // V = I * R
     }
 
+    //Companion model is just the resistance with no history source
+    virtual void GetCompanion(double /*T*/, double& Req, double& Veq) override {
+        Req = resistance;
+        Veq = 0.0;
+    }
+
+    //AC impedance is the resistance at every frequency
+    virtual std::complex<double> GetImpedance(double /*omega*/) const override {
+        return resistance;
+    }
+
     //update component state
     virtual void Update() override {}
 
@@ -0,0 +1,57 @@
+#ifndef _SAMPLERINGH
+#define _SAMPLERINGH
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Single-producer / single-consumer lock-free ring buffer.
+// Exactly one thread may call push() and exactly one other thread may call
+// pop(); no locks are taken on either side. Capacity is rounded up to a
+// power of two so indices wrap with a mask.
+template <typename T>
+class SampleRing {
+    std::vector<T> slots; // Storage for queued items
+    size_t mask; // Capacity - 1
+    alignas(64) std::atomic<size_t> head; // Next slot to read, owned by the consumer
+    alignas(64) std::atomic<size_t> tail; // Next slot to write, owned by the producer
+
+public:
+    // Create a ring holding at least minCapacity items
+    explicit SampleRing(size_t minCapacity) : head(0), tail(0) {
+        size_t capacity = 2;
+        while (capacity < minCapacity) capacity <<= 1;
+        slots.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    // Producer side: returns false if the ring is full
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false;
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: returns false if the ring is empty
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: true if nothing is queued
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    // Consumer side: drop everything still queued
+    void clear() {
+        head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
+
+#endif // _SAMPLERINGH
@@ -0,0 +1,102 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include "Component.h"
+#include "MnaSystem.h"
+
+
+// Inductor whose core saturates: flux = L0 * Isat * atan(I / Isat), so the
+// incremental inductance L0 / (1 + (I / Isat)^2) falls as the current grows.
+// Backward Euler: V = (flux(I) - flux(lastCurrent)) / T.
+class SaturableInductor final : public Component {
+	double L0; //Small-signal inductance in henrys
+	double Isat; //Current where the inductance has halved, in amps
+	double lastCurrent = 0.0; //Current at the last accepted step
+	double iIter = 0.0; //Nodal analysis Newton operating point
+	double stampedL = 0.0; //Inductance in the factored matrix
+	double stampedReq = 0.0; //stampedL / T
+	double stampedVeq = 0.0; //History source matching stampedReq at iIter
+public:
+    SaturableInductor(double val, double saturation, float R, float G, float B, std::string n)
+        : L0(val), Isat(saturation) {
+        Red = R; Green = G; Blue = B; name = n;
+    }
+
+	//Flux linkage and incremental inductance at current I
+    double Flux(double I) const { return L0 * Isat * atan(I / Isat); }
+    double Inductance(double I) const { return L0 / (1.0 + (I / Isat) * (I / Isat)); }
+
+	//Voltage across the inductor for a trial current
+    virtual double GetVoltage(double I, double T) override {
+        return (Flux(I) - Flux(lastCurrent)) / T;
+    }
+    //Tangent at the last accepted current (used by the direct solver)
+    virtual void GetCompanion(double T, double& Req, double& Veq) override {
+        Req = Inductance(lastCurrent) / T;
+        Veq = -Req * lastCurrent;
+    }
+    virtual bool IsNonlinear() const override { return true; }
+    virtual void GetVoltageAndSlope(double I, double T, double& V, double& dVdI) override {
+        V = (Flux(I) - Flux(lastCurrent)) / T;
+        dVdI = Inductance(I) / T;
+    }
+    //AC: incremental inductance at the last accepted current
+    virtual std::complex<double> GetImpedance(double omega) const override {
+        return std::complex<double>(0.0, omega * Inductance(lastCurrent));
+    }
+    virtual void Commit(double I, double /*T*/) override {
+        lastCurrent = I;
+        iIter = I;
+    }
+
+    //Nodal analysis: V = Req * I + Veq linearised at iIter
+    virtual void StampMatrix(MnaSystem& mna, double T) override {
+        stampedL = Inductance(iIter);
+        stampedReq = stampedL / T;
+        mna.AddConductance(nodeA, nodeB, 1.0 / stampedReq);
+    }
+    virtual void StampRhs(MnaSystem& mna, double /*time*/, double T) override {
+        stampedVeq = GetVoltage(iIter, T) - stampedReq * iIter;
+        mna.AddCurrent(nodeB, nodeA, stampedVeq / stampedReq);
+    }
+    virtual bool NewtonUpdate(const MnaSystem& mna, double /*T*/) override {
+        double I = (mna.NodeVoltage(nodeA) - mna.NodeVoltage(nodeB) - stampedVeq) / stampedReq;
+        bool settled = fabs(I - iIter) <= 1e-6 * fabs(I) + 1e-12;
+        iIter = I;
+        return settled;
+    }
+    virtual double JacobianDrift() const override {
+        double L = Inductance(iIter);
+        return fabs(L - stampedL) / fmax(L, stampedL);
+    }
+    virtual void AcceptSolution(const MnaSystem& /*mna*/, double T) override {
+        branchCurrent = iIter;
+        Commit(iIter, T);
+    }
+
+    //Checkpoint state, including the nodal analysis operating point
+    virtual int StateSize() const override { return 5; }
+    virtual void SaveState(std::vector<double>& out) const override {
+        out.push_back(lastCurrent);
+        out.push_back(iIter);
+        out.push_back(stampedL);
+        out.push_back(stampedReq);
+        out.push_back(stampedVeq);
+    }
+    virtual void LoadState(const double* in) override {
+        lastCurrent = in[0];
+        iIter = in[1];
+        stampedL = in[2];
+        stampedReq = in[3];
+        stampedVeq = in[4];
+    }
+
+    //update component state
+    virtual void Update() override {}
+
+	//Render the inductor visually
+    virtual void Display() override;
+
+	//Return the component name
+    virtual std::string GetName() const override { return name; }
+};
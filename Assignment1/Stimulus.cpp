@@ -0,0 +1,313 @@
+// Stimulus.cpp - Source waveforms: piecewise linear, pulse, multi-tone and sample files
+
+#define _USE_MATH_DEFINES
+#include "Stimulus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <Windows.h> // File mapping
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+double Stimulus::NextBreakpoint(double /*t*/) const {
+    return HUGE_VAL;
+}
+
+//------------------------------------------------------------------------------
+bool PwlStimulus::AddPoint(double t, double v) {
+    if (!times.empty() && !(t > times.back())) return false;
+    times.push_back(t);
+    values.push_back(v);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool PwlStimulus::Load(const string& filename) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open " << filename << endl;
+        return false;
+    }
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream fields(line);
+        double t, v;
+        if (!(fields >> t)) continue; // Blank or comment
+        if (!(fields >> v) || !AddPoint(t, v)) {
+            cerr << "Error: " << filename << " line " << lineNumber << ": expected time value, time increasing" << endl;
+            return false;
+        }
+    }
+    if (times.empty()) {
+        cerr << "Error: " << filename << " has no points" << endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Time moves forward a step at a time, so the segment is found by walking
+// from the last one
+double PwlStimulus::Value(double t) {
+    if (times.empty()) return 0.0;
+    if (t <= times.front()) return values.front();
+    if (t >= times.back()) return values.back();
+    while (segment > 0 && t < times[segment]) segment--;
+    while (t >= times[segment + 1]) segment++;
+    double f = (t - times[segment]) / (times[segment + 1] - times[segment]);
+    return values[segment] + (values[segment + 1] - values[segment]) * f;
+}
+
+//------------------------------------------------------------------------------
+double PwlStimulus::NextBreakpoint(double t) const {
+    auto it = upper_bound(times.begin(), times.end(), t);
+    return it == times.end() ? HUGE_VAL : *it;
+}
+
+//------------------------------------------------------------------------------
+PulseStimulus::PulseStimulus(double low, double high, double td, double tr, double tf, double pw, double per)
+    : v1(low), v2(high), delay(td), rise(max(tr, 0.0)), fall(max(tf, 0.0)), width(max(pw, 0.0)), period(max(per, 0.0)) {
+}
+
+//------------------------------------------------------------------------------
+double PulseStimulus::Value(double t) {
+    if (t < delay) return v1;
+    double x = t - delay;
+    if (period > 0.0) x = fmod(x, period);
+    if (x < rise) return v1 + (v2 - v1) * x / rise;
+    x -= rise;
+    if (x < width) return v2;
+    x -= width;
+    if (x < fall) return v2 + (v1 - v2) * x / fall;
+    return v1;
+}
+
+//------------------------------------------------------------------------------
+// Corners of the cycle holding t and the start of the next one
+double PulseStimulus::NextBreakpoint(double t) const {
+    if (t < delay) return delay;
+    double cycle = period > 0.0 ? floor((t - delay) / period) : 0.0;
+    double start = delay + cycle * period;
+    double corners[4] = { start + rise, start + rise + width, start + rise + width + fall, start + period };
+    for (int k = 0; k < 4; ++k) {
+        if (k == 3 && period <= 0.0) break;
+        if (corners[k] > t) return corners[k];
+    }
+    return period > 0.0 ? start + 2.0 * period : HUGE_VAL;
+}
+
+//------------------------------------------------------------------------------
+MultiToneStimulus::MultiToneStimulus()
+    : stateTime(NAN), stepLength(0.0), sinceSync(0), lastValue(0.0) {
+}
+
+//------------------------------------------------------------------------------
+void MultiToneStimulus::AddTone(double amplitude, double frequency, double phaseDegrees) {
+    tones.push_back(Tone{ amplitude, 2.0 * M_PI * frequency, phaseDegrees * M_PI / 180.0, 0.0, 0.0, 1.0, 0.0 });
+    stateTime = NAN;
+    stepLength = 0.0;
+}
+
+//------------------------------------------------------------------------------
+void MultiToneStimulus::Sync(double t) {
+    for (auto& tone : tones) {
+        double angle = tone.omega * t + tone.phase;
+        tone.c = cos(angle);
+        tone.s = sin(angle);
+    }
+    stateTime = t;
+    sinceSync = 0;
+}
+
+//------------------------------------------------------------------------------
+// A fixed-step clock's increments differ from the step in the last bits;
+// anything within 1e-9 of the step reuses its rotation (a phase error of
+// w * 1e-9 * h at worst, cleared at the next resync)
+double MultiToneStimulus::Value(double t) {
+    if (t == stateTime) return lastValue;
+    double h = t - stateTime;
+    if (!(h > 0.0) || sinceSync >= resyncSteps) Sync(t); // First call, backwards, or due
+    else {
+        if (fabs(h - stepLength) > 1e-9 * h) {
+            for (auto& tone : tones) {
+                tone.rc = cos(tone.omega * h);
+                tone.rs = sin(tone.omega * h);
+            }
+            stepLength = h;
+        }
+        for (auto& tone : tones) {
+            double c = tone.c * tone.rc - tone.s * tone.rs;
+            tone.s = tone.s * tone.rc + tone.c * tone.rs;
+            tone.c = c;
+        }
+        stateTime = t;
+        sinceSync++;
+    }
+    double sum = 0.0;
+    for (auto& tone : tones) sum += tone.amplitude * tone.s;
+    lastValue = sum;
+    return sum;
+}
+
+//------------------------------------------------------------------------------
+SampleFileStimulus::SampleFileStimulus()
+    : data(nullptr), bytes(0), windowStart(0), windowLength(0), granularity(1), sampleCount(0),
+    doubles(false), rate(1.0), scale(1.0),
+#ifdef _WIN32
+    file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+#else
+    file(-1) {
+#endif
+}
+
+//------------------------------------------------------------------------------
+SampleFileStimulus::~SampleFileStimulus() {
+    Close();
+}
+
+//------------------------------------------------------------------------------
+bool SampleFileStimulus::Open(const string& filename, double sampleRate, bool float64, double gain) {
+    Close();
+    if (!(sampleRate > 0.0)) {
+        cerr << "Error: sample rate must be positive" << endl;
+        return false;
+    }
+    rate = sampleRate;
+    doubles = float64;
+    scale = gain;
+
+#ifdef _WIN32
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+        cerr << "Error: Could not open " << filename << endl;
+        Close();
+        return false;
+    }
+    bytes = static_cast<size_t>(size.QuadPart);
+    SYSTEM_INFO system;
+    GetSystemInfo(&system);
+    granularity = system.dwAllocationGranularity; // Views start on 64 KiB boundaries
+    if (bytes > 0) mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) MapWindow(0);
+#else
+    file = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0) {
+        cerr << "Error: Could not open " << filename << endl;
+        Close();
+        return false;
+    }
+    bytes = static_cast<size_t>(info.st_size);
+    granularity = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (bytes > 0) MapWindow(0);
+#endif
+    if (!data) {
+        cerr << "Error: Could not map " << filename << (bytes ? "" : " (empty file)") << endl;
+        Close();
+        return false;
+    }
+    sampleCount = bytes / (doubles ? sizeof(double) : sizeof(float));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SampleFileStimulus::Close() {
+    Unmap();
+#ifdef _WIN32
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (file >= 0) close(file);
+    file = -1;
+#endif
+    bytes = 0;
+    sampleCount = 0;
+}
+
+//------------------------------------------------------------------------------
+void SampleFileStimulus::Unmap() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+#else
+    if (data) munmap(const_cast<unsigned char*>(data), windowLength);
+#endif
+    data = nullptr;
+    windowStart = windowLength = 0;
+}
+
+//------------------------------------------------------------------------------
+// The window starts an eighth of its length before offset, so the small steps
+// back of an adaptive retry do not move it
+bool SampleFileStimulus::MapWindow(size_t offset) {
+    Unmap();
+    size_t first = offset > windowBytes / 8 ? offset - windowBytes / 8 : 0;
+    first -= first % granularity;
+    size_t length = bytes - first;
+    if (length > windowBytes) length = windowBytes;
+#ifdef _WIN32
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ,
+        DWORD(uint64_t(first) >> 32), DWORD(first & 0xFFFFFFFFu), length));
+#else
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, static_cast<off_t>(first));
+    if (p != MAP_FAILED) {
+        data = static_cast<const unsigned char*>(p);
+        madvise(p, length, MADV_SEQUENTIAL); // Read ahead within the window
+    }
+#endif
+    if (!data) return false;
+    windowStart = first;
+    windowLength = length;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// memcpy keeps the read legal for any file offset alignment
+double SampleFileStimulus::Sample(size_t i) {
+    size_t size = doubles ? sizeof(double) : sizeof(float);
+    size_t offset = i * size;
+    if (offset < windowStart || offset + size > windowStart + windowLength) {
+        if (!MapWindow(offset)) return 0.0;
+    }
+    const unsigned char* p = data + (offset - windowStart);
+    if (doubles) {
+        double v;
+        memcpy(&v, p, sizeof(double));
+        return scale * v;
+    }
+    float v;
+    memcpy(&v, p, sizeof(float));
+    return scale * v;
+}
+
+//------------------------------------------------------------------------------
+double SampleFileStimulus::Value(double t) {
+    if (sampleCount == 0 || !(t >= 0.0)) return 0.0;
+    double x = t * rate;
+    if (x > double(sampleCount - 1)) return 0.0;
+    size_t i = static_cast<size_t>(x);
+    double a = Sample(i);
+    if (i + 1 >= sampleCount) return a;
+    return a + (Sample(i + 1) - a) * (x - double(i));
+}
@@ -0,0 +1,118 @@
+#ifndef _STIMULUSH
+#define _STIMULUSH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Source waveform driving the series loop, replacing the built-in switched
+// sine. The circuit asks for Value(t) once per solve, in increasing time
+// except after an adaptive retry or a Reset(), so stateful sources may cache
+// but must accept any t.
+class Stimulus {
+public:
+    virtual ~Stimulus() {}
+    virtual double Value(double t) = 0; // Source voltage at time t
+    // First slope discontinuity after t (HUGE_VAL = none); adaptive stepping
+    // lands exactly on it
+    virtual double NextBreakpoint(double /*t*/) const;
+};
+
+// Piecewise linear: straight lines between (time, value) points, the first
+// value before the first point and the last value after the last one
+class PwlStimulus : public Stimulus {
+    std::vector<double> times, values; // Points, times strictly increasing
+    size_t segment; // Index of the last segment used, searched from here
+
+public:
+    PwlStimulus() : segment(0) {}
+    bool AddPoint(double t, double v); // False if t does not increase
+    bool Load(const std::string& filename); // "time value" per line, # comments
+    size_t Points() const { return times.size(); }
+    virtual double Value(double t) override;
+    virtual double NextBreakpoint(double t) const override;
+};
+
+// SPICE PULSE(v1 v2 delay rise fall width period): v1 until delay, ramps to
+// v2 over rise, holds for width, ramps back over fall; repeats every period
+// (0 = one pulse)
+class PulseStimulus : public Stimulus {
+    double v1, v2, delay, rise, fall, width, period;
+
+public:
+    PulseStimulus(double low, double high, double td, double tr, double tf, double pw, double per);
+    virtual double Value(double t) override;
+    virtual double NextBreakpoint(double t) const override;
+};
+
+// Sum of sines  sum(a_k sin(2 pi f_k t + phase_k)). Each tone is a rotating
+// (cos, sin) pair: a step of h multiplies it by the fixed rotation
+// (cos w h, sin w h), so a fixed-step run evaluates no sin() at all. A new
+// step length costs one sin/cos per tone to rebuild the rotation; going
+// back in time, or every resyncSteps rotations (to stop rounding drift),
+// costs one sin/cos per tone to recompute the state exactly.
+class MultiToneStimulus : public Stimulus {
+    struct Tone {
+        double amplitude, omega, phase; // a, 2 pi f, phase (rad)
+        double c, s; // cos and sin of omega t + phase at the state time
+        double rc, rs; // Rotation for one step of length stepLength
+    };
+    std::vector<Tone> tones;
+    double stateTime; // Time of the oscillator states, NaN = not synchronised
+    double stepLength; // Step the rotations were built for, 0 = none
+    int sinceSync; // Rotations since the last exact evaluation
+    double lastValue; // Value at stateTime
+
+    void Sync(double t); // Exact states at t
+
+public:
+    static const int resyncSteps = 4096;
+
+    MultiToneStimulus();
+    void AddTone(double amplitude, double frequency, double phaseDegrees = 0.0);
+    size_t Tones() const { return tones.size(); }
+    virtual double Value(double t) override;
+};
+
+// Recorded waveform in a raw binary sample file (float32 or float64, native
+// byte order, one channel, uniform rate), memory-mapped rather than read.
+// Only a window of windowBytes around the current time is mapped, and moving
+// it unmaps the old one, so at most that much of the file is ever resident
+// and files far larger than RAM can drive a run. Linear interpolation
+// between samples; 0 V before the start and after the end.
+class SampleFileStimulus : public Stimulus {
+    const unsigned char* data; // Mapped window, null when none
+    size_t bytes; // File length
+    size_t windowStart, windowLength; // File offset and length of the mapped window
+    size_t granularity; // Alignment of a window start
+    size_t sampleCount; // Whole samples in the file
+    bool doubles; // float64 samples, else float32
+    double rate; // Samples per second
+    double scale; // Multiplier applied to every sample
+#ifdef _WIN32
+    void* file; // Windows file and mapping handles
+    void* mapping;
+#else
+    int file; // File descriptor
+#endif
+
+    bool MapWindow(size_t offset); // Map the window holding file offset, false on failure
+    void Unmap(); // Release the mapped window
+    double Sample(size_t i); // Sample i, scaled, moving the window if needed (0 if it cannot be mapped)
+
+public:
+    static const size_t windowBytes = 16 << 20;
+
+    SampleFileStimulus();
+    ~SampleFileStimulus();
+    SampleFileStimulus(const SampleFileStimulus&) = delete;
+    SampleFileStimulus& operator=(const SampleFileStimulus&) = delete;
+
+    bool Open(const std::string& filename, double sampleRate, bool float64, double gain = 1.0);
+    void Close();
+    size_t Samples() const { return sampleCount; }
+    double Duration() const { return sampleCount / rate; }
+    virtual double Value(double t) override;
+};
+
+#endif // _STIMULUSH
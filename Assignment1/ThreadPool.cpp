@@ -0,0 +1,102 @@
+// ThreadPool.cpp - Work-stealing thread pool used by the batch analyses
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// Start the workers, one queue each
+ThreadPool::ThreadPool(unsigned threadCount)
+    : nextQueue(0), pending(0), stopping(false) {
+    if (threadCount == 0) threadCount = thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; ++i) queues.emplace_back(new WorkQueue);
+    for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+//------------------------------------------------------------------------------
+// Finish outstanding work, then stop and join the workers
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        lock_guard<mutex> guard(waitLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+//------------------------------------------------------------------------------
+// Queue a task on the next worker in round-robin order
+void ThreadPool::submit(function<void()> task) {
+    pending++;
+    size_t index = nextQueue++ % queues.size();
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(move(task));
+    }
+    {
+        // Taking waitLock orders this with a worker about to sleep
+        lock_guard<mutex> guard(waitLock);
+    }
+    wake.notify_one();
+}
+
+//------------------------------------------------------------------------------
+// Block until every submitted task has run
+void ThreadPool::wait() {
+    unique_lock<mutex> guard(waitLock);
+    idle.wait(guard, [this] { return pending == 0; });
+}
+
+//------------------------------------------------------------------------------
+// Newest task from the worker's own queue (better cache locality)
+bool ThreadPool::popLocal(size_t index, function<void()>& task) {
+    lock_guard<mutex> guard(queues[index]->lock);
+    if (queues[index]->tasks.empty()) return false;
+    task = move(queues[index]->tasks.back());
+    queues[index]->tasks.pop_back();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Oldest task from any other worker's queue
+bool ThreadPool::steal(size_t thief, function<void()>& task) {
+    for (size_t k = 1; k < queues.size(); ++k) {
+        WorkQueue& victim = *queues[(thief + k) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        task = move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Run local work, steal when idle, sleep when there is nothing anywhere
+void ThreadPool::workerLoop(size_t index) {
+    function<void()> task;
+    for (;;) {
+        if (popLocal(index, task) || steal(index, task)) {
+            task();
+            task = nullptr;
+            if (--pending == 0) {
+                lock_guard<mutex> guard(waitLock);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> guard(waitLock);
+        if (stopping) return;
+        // Re-check under the lock so a submit() in between is not missed
+        bool queued = false;
+        for (auto& q : queues) {
+            lock_guard<mutex> qGuard(q->lock);
+            if (!q->tasks.empty()) { queued = true; break; }
+        }
+        if (!queued) wake.wait(guard);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef _THREADPOOLH
+#define _THREADPOOLH
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it takes its own work from the back and, when
+// that runs dry, steals from the front of the other workers' deques. Tasks
+// are independent, so no ordering between them is guaranteed.
+class ThreadPool {
+    // Per-worker task queue
+    struct WorkQueue {
+        std::mutex lock; // Guards tasks
+        std::deque<std::function<void()>> tasks; // Pending tasks
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; // One queue per worker
+    std::vector<std::thread> workers; // Worker threads
+    std::atomic<size_t> nextQueue; // Round-robin target for submit()
+    std::atomic<size_t> pending; // Tasks submitted but not yet finished
+    std::atomic<bool> stopping; // Set by the destructor
+    std::mutex waitLock; // Used with wake/idle condition variables
+    std::condition_variable wake; // Signals workers that work arrived
+    std::condition_variable idle; // Signals wait() that pending reached 0
+
+    bool popLocal(size_t index, std::function<void()>& task); // Take from own back
+    bool steal(size_t thief, std::function<void()>& task); // Take from another front
+    void workerLoop(size_t index); // Worker thread body
+
+public:
+    explicit ThreadPool(unsigned threadCount = 0); // 0 = hardware concurrency
+    ~ThreadPool();
+
+    void submit(std::function<void()> task); // Queue a task
+    void wait(); // Block until every submitted task has finished
+    unsigned size() const { return static_cast<unsigned>(workers.size()); } // Number of workers
+};
+
+#endif // _THREADPOOLH
@@ -0,0 +1,414 @@
+// TraceArchive.cpp - Compressed columnar trace files: encoder, index and reader
+
+#include "TraceArchive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char archiveMagic[8] = { 'A', 'N', 'A', 'S', 'I', 'M', 'C', 'Z' };
+static const char indexMagic[8] = { 'A', 'N', 'A', 'S', 'I', 'M', 'I', 'X' };
+static const char footerMagic[8] = { 'C', 'Z', 'I', 'N', 'D', 'E', 'X', '\0' };
+static const size_t chunkHeaderBytes = 24; // rows, payload bytes, first and last time
+
+template <class Value>
+static void putValue(string& out, const Value& v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+template <class Value>
+static bool getValue(istream& in, Value& v) { return bool(in.read(reinterpret_cast<char*>(&v), sizeof(v))); }
+
+//------------------------------------------------------------------------------
+static int leadingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    for (; !(x >> 63); x <<= 1) n++;
+    return n;
+#endif
+}
+
+//------------------------------------------------------------------------------
+static int trailingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (; !(x & 1); x >>= 1) n++;
+    return n;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Round to 'keep' mantissa bits (to nearest); infinities and NaNs pass through
+static uint64_t roundBits(double v, int keep) {
+    uint64_t b;
+    memcpy(&b, &v, sizeof(b));
+    if (keep >= archiveExactBits || ((b >> 52) & 0x7ff) == 0x7ff) return b;
+    int drop = archiveExactBits - keep;
+    b += uint64_t(1) << (drop - 1);
+    return b & ~((uint64_t(1) << drop) - 1);
+}
+
+//------------------------------------------------------------------------------
+static double fromBits(uint64_t b) {
+    double v;
+    memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+//------------------------------------------------------------------------------
+// a + (a - b) rather than 2a - b, so no compiler can contract it into an
+// FMA in the encoder but not the decoder
+static uint64_t predictLinear(uint64_t last, uint64_t before, int keep) {
+    double a = fromBits(last), b = fromBits(before);
+    double p = a + (a - b);
+    return isfinite(p) ? roundBits(p, keep) : last;
+}
+
+// Most significant bit first
+struct BitWriter {
+    string& out;
+    uint64_t acc; // Pending bits in the low end
+    int count; // Number of pending bits, < 8 between calls
+
+    explicit BitWriter(string& target) : out(target), acc(0), count(0) {}
+    void Put(uint64_t bits, int n) { // n <= 32
+        acc = (acc << n) | bits;
+        count += n;
+        while (count >= 8) {
+            count -= 8;
+            out += static_cast<char>(acc >> count);
+        }
+    }
+    void Put64(uint64_t bits) {
+        Put(bits >> 32, 32);
+        Put(bits & 0xffffffffu, 32);
+    }
+    void Finish() {
+        if (count > 0) out += static_cast<char>(acc << (8 - count));
+        count = 0;
+    }
+};
+
+struct BitReader {
+    const unsigned char* data;
+    size_t bytes, next; // Input length and next byte
+    uint64_t acc;
+    int count;
+    bool overrun; // Read past the end
+
+    BitReader(const unsigned char* p, size_t n) : data(p), bytes(n), next(0), acc(0), count(0), overrun(false) {}
+    uint64_t Get(int n) { // n <= 32
+        while (count < n) {
+            if (next < bytes) acc = (acc << 8) | data[next++];
+            else {
+                acc <<= 8;
+                overrun = true;
+            }
+            count += 8;
+        }
+        count -= n;
+        return (acc >> count) & ((uint64_t(1) << n) - 1);
+    }
+    uint64_t Get64() {
+        uint64_t high = Get(32);
+        return (high << 32) | Get(32);
+    }
+};
+
+//------------------------------------------------------------------------------
+// Per value after the first (stored whole), with x = value XOR prediction:
+//   0                        x == 0
+//   10 <bits>                x fits the previous leading/trailing zero window
+//   11 <6: lead> <6: len-1> <len bits>   new window
+static void encodeColumn(string& out, const double* values, size_t rows, size_t stride, int keep, bool linear) {
+    BitWriter w(out);
+    uint64_t last = 0, before = 0;
+    int lead = -1, trail = 0; // Current window, -1 = none yet
+    for (size_t i = 0; i < rows; ++i) {
+        uint64_t v = roundBits(values[i * stride], keep);
+        if (i == 0) w.Put64(v);
+        else {
+            uint64_t x = v ^ (linear && i >= 2 ? predictLinear(last, before, keep) : last);
+            if (x == 0) w.Put(0, 1);
+            else {
+                int l = leadingZeros(x), t = trailingZeros(x);
+                if (lead >= 0 && l >= lead && t >= trail) {
+                    w.Put(2, 2);
+                    int len = 64 - lead - trail;
+                    uint64_t bits = x >> trail;
+                    if (len > 32) {
+                        w.Put(bits >> 32, len - 32);
+                        w.Put(bits & 0xffffffffu, 32);
+                    }
+                    else w.Put(bits, len);
+                }
+                else {
+                    int len = 64 - l - t;
+                    w.Put(3, 2);
+                    w.Put(uint64_t(l), 6);
+                    w.Put(uint64_t(len - 1), 6);
+                    uint64_t bits = x >> t;
+                    if (len > 32) {
+                        w.Put(bits >> 32, len - 32);
+                        w.Put(bits & 0xffffffffu, 32);
+                    }
+                    else w.Put(bits, len);
+                    lead = l;
+                    trail = t;
+                }
+            }
+        }
+        before = last;
+        last = v;
+    }
+    w.Finish();
+}
+
+//------------------------------------------------------------------------------
+static bool decodeColumn(const unsigned char* data, size_t bytes, double* values, size_t rows, size_t stride,
+    int keep, bool linear) {
+    BitReader r(data, bytes);
+    uint64_t last = 0, before = 0;
+    int lead = 0, trail = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        uint64_t v;
+        if (i == 0) v = r.Get64();
+        else {
+            uint64_t p = linear && i >= 2 ? predictLinear(last, before, keep) : last;
+            uint64_t x = 0;
+            if (r.Get(1)) {
+                if (r.Get(1)) {
+                    lead = int(r.Get(6));
+                    trail = 64 - lead - (int(r.Get(6)) + 1);
+                    if (trail < 0) return false;
+                }
+                int len = 64 - lead - trail;
+                x = len > 32 ? (r.Get(len - 32) << 32) | r.Get(32) : r.Get(len);
+                x <<= trail;
+            }
+            v = p ^ x;
+        }
+        values[i * stride] = fromBits(v);
+        before = last;
+        last = v;
+    }
+    return !r.overrun;
+}
+
+//------------------------------------------------------------------------------
+bool IsArchiveName(const string& filename) {
+    const string suffix = ".rlcz";
+    return filename.size() > suffix.size() && filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//------------------------------------------------------------------------------
+void AppendArchiveHeader(string& out, const vector<string>& names, uint32_t chunkRows, int valueBits) {
+    out.append(archiveMagic, sizeof(archiveMagic));
+    putValue(out, static_cast<uint32_t>(archiveVersion));
+    putValue(out, static_cast<uint32_t>(names.size()));
+    putValue(out, chunkRows);
+    putValue(out, static_cast<uint32_t>(valueBits));
+    for (const auto& name : names) {
+        putValue(out, static_cast<uint32_t>(name.size()));
+        out += name;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Each column is encoded with both predictors and the shorter one kept
+void AppendArchiveChunk(string& out, const double* values, size_t rows, size_t columns, int valueBits) {
+    if (rows == 0) return;
+    string payload, previous, linear;
+    for (size_t c = 0; c < columns; ++c) {
+        int keep = c == 0 ? archiveExactBits : valueBits;
+        previous.clear();
+        linear.clear();
+        encodeColumn(previous, values + c, rows, columns, keep, false);
+        encodeColumn(linear, values + c, rows, columns, keep, true);
+        bool useLinear = linear.size() < previous.size();
+        const string& best = useLinear ? linear : previous;
+        putValue(payload, static_cast<uint8_t>(useLinear));
+        putValue(payload, static_cast<uint8_t>(keep));
+        putValue(payload, static_cast<uint32_t>(best.size()));
+        payload += best;
+    }
+    putValue(out, static_cast<uint32_t>(rows));
+    putValue(out, static_cast<uint32_t>(payload.size()));
+    putValue(out, values[0]);
+    putValue(out, values[(rows - 1) * columns]);
+    out += payload;
+}
+
+//------------------------------------------------------------------------------
+void AppendArchiveIndex(string& out, const vector<ArchiveChunk>& index, uint64_t indexOffset) {
+    out.append(indexMagic, sizeof(indexMagic));
+    putValue(out, static_cast<uint64_t>(index.size()));
+    for (const auto& chunk : index) {
+        putValue(out, chunk.offset);
+        putValue(out, chunk.rows);
+        putValue(out, chunk.first);
+        putValue(out, chunk.last);
+    }
+    putValue(out, indexOffset);
+    out.append(footerMagic, sizeof(footerMagic));
+}
+
+//------------------------------------------------------------------------------
+bool ReadArchiveHeader(istream& in, vector<string>& names, uint32_t& chunkRows, int& valueBits) {
+    char magic[8];
+    uint32_t fileVersion, columns, bits;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, archiveMagic, sizeof(magic)) != 0) return false;
+    if (!getValue(in, fileVersion) || fileVersion != uint32_t(archiveVersion)) return false;
+    if (!getValue(in, columns) || !getValue(in, chunkRows) || !getValue(in, bits)) return false;
+    if (columns == 0 || columns > 1024 || bits > uint32_t(archiveExactBits)) return false;
+    valueBits = int(bits);
+    names.resize(columns);
+    for (auto& name : names) {
+        uint32_t size;
+        if (!getValue(in, size) || size > (1u << 16)) return false;
+        name.resize(size);
+        if (size && !in.read(&name[0], size)) return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void ScanArchiveChunks(istream& in, vector<ArchiveChunk>& index, uint64_t& end) {
+    uint64_t position = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, ios::end);
+    uint64_t size = static_cast<uint64_t>(in.tellg());
+    end = position;
+    while (position + chunkHeaderBytes <= size) {
+        in.seekg(position);
+        char head[chunkHeaderBytes];
+        if (!in.read(head, sizeof(head)) || memcmp(head, indexMagic, sizeof(indexMagic)) == 0) break;
+        ArchiveChunk chunk;
+        uint32_t bytes;
+        chunk.offset = position;
+        memcpy(&chunk.rows, head, 4);
+        memcpy(&bytes, head + 4, 4);
+        memcpy(&chunk.first, head + 8, 8);
+        memcpy(&chunk.last, head + 16, 8);
+        if (chunk.rows == 0 || position + chunkHeaderBytes + bytes > size) break; // Partly written
+        index.push_back(chunk);
+        position += chunkHeaderBytes + bytes;
+        end = position;
+    }
+    in.clear();
+}
+
+//------------------------------------------------------------------------------
+bool TraceArchiveReader::Open(const string& filename) {
+    in.close();
+    in.clear();
+    names.clear();
+    index.clear();
+    in.open(filename, ios::binary);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open " << filename << endl;
+        return false;
+    }
+    if (!ReadArchiveHeader(in, names, chunkRows, valueBits)) {
+        cerr << "Error: " << filename << " is not a trace archive" << endl;
+        return false;
+    }
+    streamoff headerEnd = in.tellg();
+
+    // Index from the footer when the writer closed the file
+    uint64_t indexOffset, count;
+    char magic[8];
+    in.seekg(-16, ios::end);
+    indexed = getValue(in, indexOffset) && in.read(magic, sizeof(magic))
+        && memcmp(magic, footerMagic, sizeof(magic)) == 0;
+    if (indexed) {
+        in.seekg(static_cast<streamoff>(indexOffset));
+        indexed = in.read(magic, sizeof(magic)) && memcmp(magic, indexMagic, sizeof(magic)) == 0
+            && getValue(in, count);
+        for (uint64_t k = 0; k < count && indexed; ++k) {
+            ArchiveChunk chunk;
+            indexed = getValue(in, chunk.offset) && getValue(in, chunk.rows) && getValue(in, chunk.first)
+                && getValue(in, chunk.last);
+            index.push_back(chunk);
+        }
+    }
+    if (!indexed) {
+        index.clear();
+        in.clear();
+        in.seekg(headerEnd);
+        uint64_t end;
+        ScanArchiveChunks(in, index, end);
+    }
+    in.clear();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t TraceArchiveReader::Rows() const {
+    size_t rows = 0;
+    for (const auto& chunk : index) rows += chunk.rows;
+    return rows;
+}
+
+//------------------------------------------------------------------------------
+bool TraceArchiveReader::DecodeChunk(size_t chunk) {
+    const ArchiveChunk& entry = index[chunk];
+    uint32_t rows, bytes;
+    in.clear();
+    in.seekg(static_cast<streamoff>(entry.offset));
+    if (!getValue(in, rows) || !getValue(in, bytes) || rows != entry.rows) return false;
+    in.seekg(16, ios::cur);
+    payload.resize(bytes);
+    if (!in.read(reinterpret_cast<char*>(payload.data()), bytes)) return false;
+
+    size_t columns = names.size(), at = 0;
+    decoded.resize(size_t(rows) * columns);
+    for (size_t c = 0; c < columns; ++c) {
+        if (at + 6 > payload.size()) return false;
+        bool linear = payload[at] != 0;
+        int keep = payload[at + 1];
+        uint32_t length;
+        memcpy(&length, &payload[at + 2], 4);
+        at += 6;
+        if (at + length > payload.size()
+            || !decodeColumn(&payload[at], length, decoded.data() + c, rows, columns, keep, linear)) return false;
+        at += length;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool TraceArchiveReader::ReadChunk(size_t chunk, vector<double>& values) {
+    values.clear();
+    if (chunk >= index.size() || !DecodeChunk(chunk)) return false;
+    values.swap(decoded);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Stored times are the circuit's accumulated clock (30005 additions of 1e-4
+// give 3.0004999999999...), so the bounds are widened by the same 1e-9
+// relative slack WaveformHistory allows for clock rounding
+bool TraceArchiveReader::Read(double from, double to, vector<double>& values) {
+    values.clear();
+    size_t columns = names.size();
+    from -= 1e-9 * fabs(from);
+    to += 1e-9 * fabs(to);
+    auto first = lower_bound(index.begin(), index.end(), from,
+        [](const ArchiveChunk& chunk, double t) { return chunk.last < t; });
+    for (size_t k = size_t(first - index.begin()); k < index.size() && index[k].first <= to; ++k) {
+        if (!DecodeChunk(k)) {
+            cerr << "Error: chunk " << k << " of the trace archive is damaged" << endl;
+            return false;
+        }
+        for (size_t row = 0; row < index[k].rows; ++row) {
+            const double* v = &decoded[row * columns];
+            if (v[0] >= from && v[0] <= to) values.insert(values.end(), v, v + columns);
+        }
+    }
+    return true;
+}
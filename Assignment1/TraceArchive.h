@@ -0,0 +1,96 @@
+#ifndef _TRACEARCHIVEH
+#define _TRACEARCHIVEH
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Compressed columnar trace file, written by TraceWriter for data file names
+// ending in ".rlcz" instead of the fixed-width text.
+//
+// Layout (native byte order, like the checkpoints):
+//   header  "ANASIMCZ", version, column count, rows per chunk, value bits,
+//           column names
+//   chunks  rows, payload bytes, first and last time, then per column a
+//           predictor, kept mantissa bits, length and the bit stream
+//   index   offset, rows, first and last time of every chunk
+//   footer  index offset, "CZINDEX"
+// A file without a footer (a killed run) is read by walking the chunk
+// headers instead of the index.
+//
+// Each column of a chunk is encoded on its own, Gorilla style: every value is
+// XORed with a prediction, either the previous value or the straight line
+// through the previous two (whichever is shorter for that chunk), and only
+// the bits between the leading and trailing zeros are stored. Time is always
+// kept exactly; the other columns keep valueBits mantissa bits (52 = exact),
+// which gives runs of trailing zeros. The default of 24 (float precision) is
+// lossy in the last digit of the text output: a value is rounded once to 24
+// bits and again to 6 digits, so printing it back can differ by 1 in the
+// sixth digit from printing the original. Chunks are independent, so any time window
+// decodes only the chunks it overlaps.
+const int archiveVersion = 1;
+const uint32_t archiveChunkRows = 4096; // Rows per chunk
+const int archiveExactBits = 52; // Mantissa bits of a double
+
+// Where each chunk sits, for the index and for seeking
+struct ArchiveChunk {
+    uint64_t offset; // File offset of the chunk header
+    uint32_t rows; // Rows in the chunk
+    double first, last; // Time of its first and last row
+};
+
+bool IsArchiveName(const std::string& filename); // Ends in ".rlcz"
+
+// Header written before the first chunk
+void AppendArchiveHeader(std::string& out, const std::vector<std::string>& names, uint32_t chunkRows, int valueBits);
+
+// Encode rows x columns values (row-major) as one chunk; column 0 is time
+void AppendArchiveChunk(std::string& out, const double* values, size_t rows, size_t columns, int valueBits);
+
+// Index and footer, written last
+void AppendArchiveIndex(std::string& out, const std::vector<ArchiveChunk>& index, uint64_t indexOffset);
+
+// Parse the header at the start of a file; false if it is not an archive
+bool ReadArchiveHeader(std::istream& in, std::vector<std::string>& names, uint32_t& chunkRows, int& valueBits);
+
+// Chunk entries found by walking the chunk headers from the current
+// position, stopping at the index, the end, or a partly written chunk;
+// 'end' receives the offset just past the last whole chunk
+void ScanArchiveChunks(std::istream& in, std::vector<ArchiveChunk>& index, uint64_t& end);
+
+// Random access reader for .rlcz files
+class TraceArchiveReader {
+    std::ifstream in;
+    std::vector<std::string> names; // Column names, time first
+    std::vector<ArchiveChunk> index; // Every chunk, in time order
+    uint32_t chunkRows;
+    int valueBits;
+    bool indexed; // Index read from the footer, else recovered by a scan
+    std::vector<unsigned char> payload; // Chunk being decoded
+    std::vector<double> decoded; // Its values, row-major
+
+    bool DecodeChunk(size_t chunk); // Into 'decoded'
+
+public:
+    TraceArchiveReader() : chunkRows(0), valueBits(archiveExactBits), indexed(false) {}
+
+    bool Open(const std::string& filename);
+    const std::vector<std::string>& Names() const { return names; }
+    size_t Columns() const { return names.size(); }
+    size_t Chunks() const { return index.size(); }
+    size_t Rows() const; // All rows in the file
+    int ValueBits() const { return valueBits; }
+    bool Indexed() const { return indexed; }
+    double StartTime() const { return index.empty() ? 0.0 : index.front().first; }
+    double EndTime() const { return index.empty() ? 0.0 : index.back().last; }
+
+    // Rows with from <= time <= to (give or take 1e-9 relative, for clock
+    // rounding), row-major; only the chunks that overlap the window are read
+    // and decoded
+    bool Read(double from, double to, std::vector<double>& values);
+    bool ReadChunk(size_t chunk, std::vector<double>& values); // Every row of one chunk, row-major
+};
+
+#endif // _TRACEARCHIVEH
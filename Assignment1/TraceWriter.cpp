@@ -0,0 +1,227 @@
+// TraceWriter.cpp - Buffered background writer for simulation traces
+
+#include "TraceWriter.h"
+
+#include <cstdio>
+#include <filesystem>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+TraceWriter::TraceWriter(size_t bytesPerBuffer)
+    : bufferSize(bytesPerBuffer), policy(FLUSH_ON_FULL_BUFFER), flushRows(1), rowsSinceFlush(0),
+    archive(false), archiveBits(24), columns(0), handedOff(0),
+    flushRequested(false), stopping(false), busy(false), failed(false) {
+}
+
+//------------------------------------------------------------------------------
+TraceWriter::~TraceWriter() {
+    Close();
+}
+
+//------------------------------------------------------------------------------
+// Open the file and start the writer thread
+bool TraceWriter::Open(const string& filename, bool append) {
+    Close();
+    archive = IsArchiveName(filename);
+    columns = 0;
+    pending.clear();
+    chunks.clear();
+    handedOff = 0;
+    failed = false;
+    if (archive && append && !ReopenArchive(filename)) return false;
+    out.open(filename, (append ? ios::app : ios::trunc) | (archive ? ios::binary : ios::openmode()));
+    if (!out.is_open()) return false;
+
+    stopping = false;
+    current.reserve(bufferSize + 256);
+    writer = thread(&TraceWriter::WriterLoop, this);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Appending picks up the column count and chunk list from the file, and
+// cuts off anything after the last whole chunk (an old index)
+bool TraceWriter::ReopenArchive(const string& filename) {
+    ifstream in(filename, ios::binary);
+    vector<string> names;
+    uint32_t chunkRows;
+    int bits;
+    if (!in.is_open() || !ReadArchiveHeader(in, names, chunkRows, bits)) return false;
+    uint64_t end;
+    ScanArchiveChunks(in, chunks, end);
+    in.close();
+    error_code error;
+    if (filesystem::file_size(filename, error) != end && !error) filesystem::resize_file(filename, end, error);
+    if (error) return false;
+    columns = names.size();
+    handedOff = end;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void TraceWriter::SetArchiveBits(int bits) {
+    archiveBits = bits < 1 ? 1 : bits > archiveExactBits ? archiveExactBits : bits;
+}
+
+//------------------------------------------------------------------------------
+void TraceWriter::SetFlushPolicy(FlushPolicy which, int rows) {
+    policy = which;
+    flushRows = rows > 0 ? rows : 1;
+    rowsSinceFlush = 0;
+}
+
+//------------------------------------------------------------------------------
+// Header row: each name right-aligned in 12 characters, like setw(12)
+void TraceWriter::WriteHeader(const vector<string>& names) {
+    if (!out.is_open()) return;
+    if (archive) {
+        columns = names.size();
+        AppendArchiveHeader(current, names, archiveChunkRows, archiveBits);
+        HandOff(true);
+        return;
+    }
+    char text[64];
+    for (const auto& name : names) {
+        if (name.size() >= 12) current += name;
+        else {
+            snprintf(text, sizeof(text), "%12s", name.c_str());
+            current += text;
+        }
+    }
+    current += '\n';
+    HandOff(true); // Header is tiny, make it visible straight away
+}
+
+//------------------------------------------------------------------------------
+// "%12g" is exactly what setw(12) << double produces with default stream flags
+void TraceWriter::WriteRow(const double* values, int count) {
+    if (!out.is_open()) return;
+    if (archive) {
+        if (size_t(count) != columns) return; // No header, or a different row shape
+        pending.insert(pending.end(), values, values + count);
+        if (pending.size() >= archiveChunkRows * columns) {
+            EmitChunk();
+            if (current.size() >= bufferSize) HandOff(false);
+        }
+        return;
+    }
+    char text[32];
+    for (int i = 0; i < count; ++i) {
+        int n = snprintf(text, sizeof(text), "%12g", values[i]);
+        current.append(text, n);
+    }
+    current += '\n';
+
+    if (policy == FLUSH_EVERY_ROWS && ++rowsSinceFlush >= flushRows) {
+        rowsSinceFlush = 0;
+        HandOff(true);
+    }
+    else if (current.size() >= bufferSize) {
+        HandOff(false);
+    }
+}
+
+//------------------------------------------------------------------------------
+void TraceWriter::EmitChunk() {
+    if (pending.empty()) return;
+    size_t rows = pending.size() / columns;
+    chunks.push_back(ArchiveChunk{ handedOff + current.size(), static_cast<uint32_t>(rows),
+        pending.front(), pending[(rows - 1) * columns] });
+    AppendArchiveChunk(current, pending.data(), rows, columns, archiveBits);
+    pending.clear();
+}
+
+//------------------------------------------------------------------------------
+// Queue the current buffer and continue with a recycled one
+void TraceWriter::HandOff(bool flush) {
+    unique_lock<mutex> guard(lock);
+    // Bound memory if the disk cannot keep up with the simulation
+    done.wait(guard, [this] { return fullBuffers.size() < maxQueued; });
+    handedOff += current.size();
+    if (!current.empty()) fullBuffers.push_back(move(current));
+    if (flush) flushRequested = true;
+    if (!freeBuffers.empty()) {
+        current = move(freeBuffers.back());
+        freeBuffers.pop_back();
+    }
+    else {
+        current = string();
+        current.reserve(bufferSize + 256);
+    }
+    current.clear();
+    work.notify_one();
+}
+
+//------------------------------------------------------------------------------
+// Wait until every row so far has been written and the stream flushed
+bool TraceWriter::Flush() {
+    if (!out.is_open()) return !failed;
+    HandOff(true);
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [this] { return fullBuffers.empty() && !busy && !flushRequested; });
+    return !failed;
+}
+
+//------------------------------------------------------------------------------
+// The writer is idle after Flush(), so the stream can be queried here. An
+// archive ends its chunk early, so the position is a chunk boundary a
+// resumed run can append to
+long long TraceWriter::Position() {
+    if (!out.is_open()) return -1;
+    if (archive) EmitChunk();
+    if (!Flush()) return -1;
+    out.seekp(0, ios::end);
+    return static_cast<long long>(out.tellp());
+}
+
+//------------------------------------------------------------------------------
+// Stays false after a failure until the next Open()
+bool TraceWriter::Close() {
+    if (!writer.joinable()) return !failed;
+    if (archive && columns > 0) {
+        EmitChunk();
+        AppendArchiveIndex(current, chunks, handedOff + current.size());
+    }
+    Flush();
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    work.notify_one();
+    writer.join();
+    out.close();
+    if (out.fail()) failed = true;
+    return !failed;
+}
+
+//------------------------------------------------------------------------------
+// Write queued buffers in order; flush only when asked or at shutdown. A bad
+// stream stays bad, so the first failure is latched and later buffers are
+// simply recycled
+void TraceWriter::WriterLoop() {
+    unique_lock<mutex> guard(lock);
+    for (;;) {
+        work.wait(guard, [this] { return stopping || !fullBuffers.empty() || flushRequested; });
+
+        while (!fullBuffers.empty()) {
+            string buffer = move(fullBuffers.front());
+            fullBuffers.pop_front();
+            busy = true;
+            guard.unlock();
+            bool written = bool(out.write(buffer.data(), buffer.size()));
+            buffer.clear();
+            guard.lock();
+            if (!written) failed = true;
+            busy = false;
+            freeBuffers.push_back(move(buffer));
+            done.notify_all();
+        }
+        if (flushRequested) {
+            if (!out.flush()) failed = true;
+            flushRequested = false;
+        }
+        done.notify_all();
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef _TRACEWRITERH
+#define _TRACEWRITERH
+
+#include "TraceArchive.h" // Columnar file layout
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// When buffered trace data is pushed out to the file
+enum FlushPolicy {
+    FLUSH_ON_FULL_BUFFER, // Only when a buffer fills up and at Close()
+    FLUSH_EVERY_ROWS      // Also after every flushRows rows (1 = old per-step endl behaviour)
+};
+
+// Buffered asynchronous writer for the fixed-width RLC.dat text layout.
+// Rows are formatted into large in-memory buffers on the simulation thread;
+// full buffers are handed to a background thread that writes them out, so the
+// hot loop never waits on the file. Output is byte-identical to streaming
+// each value with setw(12) and ending rows with endl.
+//
+// A file name ending in ".rlcz" selects the compressed columnar layout
+// (TraceArchive.h) instead: rows are collected into chunks, each chunk is
+// encoded on the simulation thread when it fills (cheaper than formatting
+// its rows as text) and handed to the same writer thread, and Close() adds
+// the chunk index. Rows reach the file a whole chunk at a time, so the row
+// flush policy does not apply.
+//
+// The writer thread cannot report a failed write (disk full, bad device) to
+// the row that caused it, so the failure is latched and returned by the next
+// Flush(), Position() or Close(); rows after it are dropped.
+class TraceWriter {
+    std::ofstream out; // Destination, text mode so line endings match the old output
+    size_t bufferSize; // Bytes per buffer before hand-off
+    FlushPolicy policy; // Flush policy for rows
+    int flushRows; // Rows between flushes for FLUSH_EVERY_ROWS
+    int rowsSinceFlush; // Rows formatted since the last flush
+
+    bool archive; // Columnar .rlcz output instead of text
+    int archiveBits; // Mantissa bits kept for the values (time is exact)
+    size_t columns; // Values per row in the archive
+    std::vector<double> pending; // Rows waiting for the next chunk, row-major
+    std::vector<ArchiveChunk> chunks; // Chunks handed off so far
+    uint64_t handedOff; // Bytes handed to the writer thread, file offset of 'current'
+
+    std::string current; // Buffer being filled by the producer
+    std::deque<std::string> fullBuffers; // Waiting for the writer thread
+    static const size_t maxQueued = 8; // Producer waits beyond this many full buffers
+    std::vector<std::string> freeBuffers; // Recycled buffers
+    bool flushRequested; // Writer should flush the stream after the queue drains
+    bool stopping; // Writer should exit once the queue is empty
+    bool busy; // Writer is currently writing a buffer
+    bool failed; // A write or flush to the file failed since Open()
+    std::mutex lock; // Guards the queue and flags
+    std::condition_variable work; // Producer -> writer
+    std::condition_variable done; // Writer -> producer (queue drained)
+    std::thread writer; // Background writer thread
+
+    void WriterLoop(); // Background thread body
+    void HandOff(bool flush); // Queue the current buffer for writing
+    void EmitChunk(); // Encode the pending rows as one chunk
+    bool ReopenArchive(const std::string& filename); // Continue an existing archive
+
+public:
+    explicit TraceWriter(size_t bytesPerBuffer = 1 << 20);
+    ~TraceWriter();
+
+    bool Open(const std::string& filename, bool append = false); // Start writing to a file
+    bool IsOpen() const { return out.is_open(); }
+    void SetFlushPolicy(FlushPolicy which, int rows = 1); // Choose when rows reach the file
+    void SetArchiveBits(int bits); // Value precision of .rlcz files, 52 = exact (default 24)
+    bool IsArchive() const { return archive; }
+
+    void WriteHeader(const std::vector<std::string>& names); // Right-aligned column names
+    void WriteRow(const double* values, int count); // One row of setw(12) values
+    bool Flush(); // Block until everything written so far is in the file, false if any write failed
+    long long Position(); // Flush, then the file length in bytes (-1 if not open or a write failed); ends the archive chunk
+    bool Close(); // Flush (writing the archive index) and stop the writer thread, false if any write failed
+};
+
+#endif // _TRACEWRITERH
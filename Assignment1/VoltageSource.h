@@ -0,0 +1,61 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include "Component.h"
+#include "MnaSystem.h"
+
+
+// Independent voltage source  V(t) = dc + amplitude * sin(2 pi freq t),
+// used by the nodal analysis engine. It adds one branch unknown (its current).
+class VoltageSource final : public Component {
+	double dc; //DC offset in volts
+	double amplitude; //Sine amplitude in volts
+	double freq; //Sine frequency in hertz
+	double value; //Voltage at the last stamped time
+public:
+    VoltageSource(double offset, double amp, double frequency, float R, float G, float B, std::string n)
+        : dc(offset), amplitude(amp), freq(frequency), value(offset) {
+        Red = R; Green = G; Blue = B; name = n;
+    }
+
+	//Source voltage at time t
+    double GetValue(double t) const {
+        return dc + amplitude * sin(2.0 * 3.14159265358979323846 * freq * t);
+    }
+
+	//Voltage across the source is fixed by the waveform
+    virtual double GetVoltage(double /*I*/, double /*T*/) override {
+        return value;
+    }
+    //Ideal source: no resistance, voltage is the waveform
+    virtual void GetCompanion(double /*T*/, double& Req, double& Veq) override {
+        Req = 0.0;
+        Veq = value;
+    }
+
+    //Nodal analysis: one extra unknown for the source current
+    virtual int BranchCount() const override { return 1; }
+    virtual void StampMatrix(MnaSystem& mna, double /*T*/) override {
+        int a = mna.NodeUnknown(nodeA), b = mna.NodeUnknown(nodeB), k = mna.BranchUnknown(branch);
+        mna.AddEntry(a, k, 1.0);
+        mna.AddEntry(b, k, -1.0);
+        mna.AddEntry(k, a, 1.0);
+        mna.AddEntry(k, b, -1.0);
+    }
+    virtual void StampRhs(MnaSystem& mna, double time, double /*T*/) override {
+        value = GetValue(time);
+        mna.AddRhs(mna.BranchUnknown(branch), value);
+    }
+    virtual void AcceptSolution(const MnaSystem& mna, double /*T*/) override {
+        branchCurrent = mna.Unknown(mna.BranchUnknown(branch));
+    }
+
+    //update component state
+    virtual void Update() override {}
+
+	//Render the source visually
+    virtual void Display() override;
+
+	//Return the component name
+    virtual std::string GetName() const override { return name; }
+};
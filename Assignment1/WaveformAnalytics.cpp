@@ -0,0 +1,269 @@
+// WaveformAnalytics.cpp - Single-pass RMS, peak, phase and harmonic metrics
+
+#include "WaveformAnalytics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+static const double twoPi = 2.0 * 3.14159265358979323846;
+static const int phasorSync = 256; // Rotations between exact phasors
+static const char* const channelNames[CHANNEL_COUNT] = { "vin", "vR", "vC", "vL", "current" };
+
+//------------------------------------------------------------------------------
+// Degrees in (-180, 180]
+static double wrapDegrees(double degrees) {
+    degrees = fmod(degrees, 360.0);
+    if (degrees > 180.0) degrees -= 360.0;
+    if (degrees <= -180.0) degrees += 360.0;
+    return degrees + 0.0; // No -0 in the summary
+}
+
+//------------------------------------------------------------------------------
+WaveformAnalytics::WaveformAnalytics(double frequency, int harmonicCount)
+    : freq(frequency), harmonics(max(1, harmonicCount)), from(0.0), to(HUGE_VAL) {
+    Reset();
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::SetWindow(double start, double end) {
+    from = start;
+    to = end;
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::Reset() {
+    for (auto& c : channels) {
+        c.peak = c.peakTime = 0.0;
+        c.minimum = HUGE_VAL;
+        c.maximum = -HUGE_VAL;
+        c.sum = c.squares = 0.0;
+        c.firstRising = c.lastRising = -1.0;
+        c.risingCount = 0;
+        c.re.assign(harmonics, 0.0);
+        c.im.assign(harmonics, 0.0);
+    }
+    duration = 0.0;
+    samples = 0;
+    lastTime = 0.0;
+    fill(last, last + CHANNEL_COUNT, 0.0);
+    phasor.assign(2 * harmonics, 0.0);
+    lastPhasor.assign(2 * harmonics, 0.0);
+    phasorValid = false;
+    rotStep = 0.0;
+    rotCos = 1.0;
+    rotSin = 0.0;
+    sinceSync = 0;
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::ExactPhasor(double t, vector<double>& p) const {
+    for (int h = 0; h < harmonics; ++h) {
+        double angle = twoPi * freq * (h + 1) * t;
+        p[2 * h] = cos(angle);
+        p[2 * h + 1] = sin(angle);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Rotate the fundamental by w (t - lastTime), then each harmonic is the one
+// below it times the fundamental
+void WaveformAnalytics::AdvancePhasor(double t) {
+    if (!phasorValid || ++sinceSync >= phasorSync) {
+        ExactPhasor(t, phasor);
+        sinceSync = 0;
+        return;
+    }
+    double dt = t - lastTime;
+    if (dt != rotStep) {
+        rotStep = dt;
+        rotCos = cos(twoPi * freq * dt);
+        rotSin = sin(twoPi * freq * dt);
+    }
+    double c1 = lastPhasor[0] * rotCos - lastPhasor[1] * rotSin;
+    double s1 = lastPhasor[1] * rotCos + lastPhasor[0] * rotSin;
+    phasor[0] = c1;
+    phasor[1] = s1;
+    for (int h = 1; h < harmonics; ++h) {
+        double c = phasor[2 * h - 2], s = phasor[2 * h - 1];
+        phasor[2 * h] = c * c1 - s * s1;
+        phasor[2 * h + 1] = s * c1 + c * s1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Trapezoid over [ta, tb], which lies inside the window
+void WaveformAnalytics::Integrate(double ta, const double* xa, const double* pa, double tb, const double* xb, const double* pb) {
+    double half = 0.5 * (tb - ta);
+    duration += tb - ta;
+    for (int k = 0; k < CHANNEL_COUNT; ++k) {
+        ChannelStats& c = channels[k];
+        double a = xa[k], b = xb[k];
+        c.sum += half * (a + b);
+        c.squares += half * (a * a + b * b);
+        c.minimum = min(c.minimum, min(a, b));
+        c.maximum = max(c.maximum, max(a, b));
+        for (int h = 0; h < harmonics; ++h) {
+            c.re[h] += half * (a * pa[2 * h] + b * pb[2 * h]);
+            c.im[h] -= half * (a * pa[2 * h + 1] + b * pb[2 * h + 1]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::Add(const Sample& s) {
+    const double x[CHANNEL_COUNT] = { s.vin, s.vR, s.vC, s.vL, s.current };
+    double t = s.time;
+    for (int k = 0; k < CHANNEL_COUNT; ++k) {
+        if (fabs(x[k]) > channels[k].peak) {
+            channels[k].peak = fabs(x[k]);
+            channels[k].peakTime = t;
+        }
+    }
+
+    bool advanced = false; // phasor now belongs to t
+    if (samples > 0 && t > lastTime) {
+        double ta = lastTime;
+        for (int k = 0; k < CHANNEL_COUNT; ++k) {
+            if (!(last[k] < 0.0 && x[k] >= 0.0)) continue;
+            double crossing = ta + (t - ta) * -last[k] / (x[k] - last[k]);
+            if (crossing < from || crossing > to) continue;
+            ChannelStats& c = channels[k];
+            if (c.risingCount++ == 0) c.firstRising = crossing;
+            c.lastRising = crossing;
+        }
+
+        if (ta >= from && t <= to) {
+            if (!phasorValid) ExactPhasor(ta, lastPhasor);
+            phasorValid = true;
+            AdvancePhasor(t);
+            advanced = true;
+            Integrate(ta, last, lastPhasor.data(), t, x, phasor.data());
+        }
+        else if (t > from && ta < to) {
+            // Cut by a window edge: interpolate the values at the edges
+            double lo = max(ta, from), hi = min(t, to);
+            double xLo[CHANNEL_COUNT], xHi[CHANNEL_COUNT];
+            for (int k = 0; k < CHANNEL_COUNT; ++k) {
+                xLo[k] = last[k] + (x[k] - last[k]) * (lo - ta) / (t - ta);
+                xHi[k] = last[k] + (x[k] - last[k]) * (hi - ta) / (t - ta);
+            }
+            vector<double> pLo(2 * harmonics);
+            ExactPhasor(lo, pLo);
+            ExactPhasor(hi, phasor);
+            advanced = hi == t;
+            sinceSync = 0;
+            Integrate(lo, xLo, pLo.data(), hi, xHi, phasor.data());
+        }
+    }
+
+    if (advanced) swap(phasor, lastPhasor);
+    phasorValid = advanced;
+    lastTime = t;
+    copy(x, x + CHANNEL_COUNT, last);
+    samples++;
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::Mean(AnalyticsChannel c) const {
+    return duration > 0.0 ? channels[c].sum / duration : NAN;
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::Rms(AnalyticsChannel c) const {
+    return duration > 0.0 ? sqrt(max(0.0, channels[c].squares / duration)) : NAN;
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::Amplitude(AnalyticsChannel c, int h) const {
+    if (duration <= 0.0 || h < 1 || h > harmonics) return NAN;
+    return 2.0 * hypot(channels[c].re[h - 1], channels[c].im[h - 1]) / duration;
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::Phase(AnalyticsChannel c) const {
+    if (duration <= 0.0) return NAN;
+    const ChannelStats& x = channels[c];
+    const ChannelStats& ref = channels[CHANNEL_VIN];
+    double radians = atan2(x.im[0], x.re[0]) - atan2(ref.im[0], ref.re[0]);
+    return wrapDegrees(radians * 360.0 / twoPi);
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::CrossingPhase(AnalyticsChannel c) const {
+    double t = channels[c].lastRising, ref = channels[CHANNEL_VIN].lastRising;
+    if (t < 0.0 || ref < 0.0) return NAN;
+    return wrapDegrees(-360.0 * freq * (t - ref));
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::CrossingFrequency(AnalyticsChannel c) const {
+    const ChannelStats& x = channels[c];
+    if (x.risingCount < 2 || x.lastRising <= x.firstRising) return NAN;
+    return (x.risingCount - 1) / (x.lastRising - x.firstRising);
+}
+
+//------------------------------------------------------------------------------
+double WaveformAnalytics::Thd(AnalyticsChannel c) const {
+    double fundamental = Amplitude(c, 1), sum = 0.0;
+    for (int h = 2; h <= harmonics; ++h) sum += Amplitude(c, h) * Amplitude(c, h);
+    return fundamental > 0.0 ? sqrt(sum) / fundamental : NAN;
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::WriteNumber(ostream& out, double value) const {
+    if (std::isfinite(value)) out << value;
+    else out << "null";
+}
+
+//------------------------------------------------------------------------------
+void WaveformAnalytics::WriteSummary(ostream& out) const {
+    out << "{\n  \"frequency\": " << freq << ", \"harmonics\": " << harmonics << ", \"samples\": " << samples
+        << ",\n  \"window\": [" << from << ", " << min(to, lastTime) << "], \"window_seconds\": " << duration
+        << ", \"periods\": " << duration * freq << ",\n  \"channels\": {";
+    for (int k = 0; k < CHANNEL_COUNT; ++k) {
+        AnalyticsChannel c = AnalyticsChannel(k);
+        const ChannelStats& x = channels[k];
+        out << (k ? "," : "") << "\n    \"" << channelNames[k] << "\": {\"rms\": ";
+        WriteNumber(out, Rms(c));
+        out << ", \"mean\": ";
+        WriteNumber(out, Mean(c));
+        out << ", \"min\": ";
+        WriteNumber(out, x.minimum);
+        out << ", \"max\": ";
+        WriteNumber(out, x.maximum);
+        out << ", \"peak\": " << x.peak << ", \"peak_time\": " << x.peakTime << ",\n      \"phase_deg\": ";
+        WriteNumber(out, Phase(c));
+        out << ", \"crossing_phase_deg\": ";
+        WriteNumber(out, CrossingPhase(c));
+        out << ", \"crossing_hz\": ";
+        WriteNumber(out, CrossingFrequency(c));
+        out << ", \"thd\": ";
+        WriteNumber(out, Thd(c));
+        out << ",\n      \"amplitudes\": [";
+        for (int h = 1; h <= harmonics; ++h) {
+            if (h > 1) out << ", ";
+            WriteNumber(out, Amplitude(c, h));
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+}
+
+//------------------------------------------------------------------------------
+bool WaveformAnalytics::WriteSummary(const string& filename) const {
+    if (filename == "-") {
+        WriteSummary(cout);
+        return true;
+    }
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open " << filename << " for writing" << endl;
+        return false;
+    }
+    WriteSummary(out);
+    return bool(out);
+}
@@ -0,0 +1,86 @@
+#ifndef _WAVEFORMANALYTICSH
+#define _WAVEFORMANALYTICSH
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AnalogCircuit.h" // Sample
+
+// Waveforms of a Sample, in the order they are analysed and reported
+enum AnalyticsChannel {
+    CHANNEL_VIN,     // Source voltage, the phase reference
+    CHANNEL_VR,      // Resistor voltage
+    CHANNEL_VC,      // Capacitor voltage
+    CHANNEL_VL,      // Inductor voltage
+    CHANNEL_CURRENT, // Loop current
+    CHANNEL_COUNT
+};
+
+// Waveform metrics computed in one pass while the circuit runs, so a run that
+// only needs the numbers keeps no trace and never re-reads a data file. Feed
+// every sample to Add() (AnalogCircuit does this itself once SetAnalytics is
+// called); memory is fixed by the harmonic count.
+//
+// Everything except the peak is measured over the analysis window [from, to],
+// which should span whole periods of the fundamental (the source frequency):
+// mean and RMS, min and max, the latest rising zero crossing of each channel
+// and the Fourier integrals of harmonics 1..H. The integrals use the
+// trapezoidal rule on the samples as given, so adaptive steps are fine; the
+// intervals cut by the window edges are clipped with linear interpolation.
+// The harmonic phasors are advanced by complex rotation and recomputed
+// exactly every few hundred samples, so the per-step cost is a few
+// multiply-adds per channel and harmonic. Phases are in degrees relative to
+// the source, positive = leading. Checkpoints do not hold this state, so a
+// resumed run analyses only the steps it takes itself.
+class WaveformAnalytics {
+    struct ChannelStats {
+        double peak, peakTime; // Largest |x| over the whole run and when
+        double minimum, maximum; // Over the window
+        double sum, squares; // Integrals of x and x^2 over the window
+        double firstRising, lastRising; // Rising zero crossings in the window, -1 = none
+        size_t risingCount; // Rising zero crossings in the window
+        std::vector<double> re, im; // Integrals of x e^(-j h w t) for h = 1..H
+    };
+
+    double freq; // Fundamental (Hz)
+    int harmonics; // H
+    double from, to; // Analysis window
+    ChannelStats channels[CHANNEL_COUNT];
+    double duration; // Window time covered so far
+    size_t samples; // Samples added
+    double lastTime; // Time of the previous sample
+    double last[CHANNEL_COUNT]; // Values of the previous sample
+    std::vector<double> phasor, lastPhasor; // cos and sin of h w t for h = 1..H, interleaved
+    bool phasorValid; // lastPhasor belongs to lastTime
+    double rotStep, rotCos, rotSin; // Rotation of the fundamental by w * rotStep
+    int sinceSync; // Rotations since the last exact phasor
+
+    void ExactPhasor(double t, std::vector<double>& p) const; // cos/sin of h w t from scratch
+    void AdvancePhasor(double t); // phasor at t from lastPhasor
+    void Integrate(double ta, const double* xa, const double* pa, double tb, const double* xb, const double* pb);
+    void WriteNumber(std::ostream& out, double value) const; // null when undefined
+
+public:
+    WaveformAnalytics(double frequency, int harmonicCount = 10);
+
+    void SetWindow(double start, double end); // Analysis window, call before the first sample
+    void Reset(); // Forget every sample, keep the window
+    void Add(const Sample& s); // Next sample, times increasing
+
+    size_t Samples() const { return samples; }
+    double WindowSeconds() const { return duration; }
+    double Mean(AnalyticsChannel c) const;
+    double Rms(AnalyticsChannel c) const;
+    double Peak(AnalyticsChannel c) const { return channels[c].peak; }
+    double Amplitude(AnalyticsChannel c, int h) const; // Peak amplitude of harmonic h (1 = fundamental)
+    double Phase(AnalyticsChannel c) const; // Fundamental, relative to the source
+    double CrossingPhase(AnalyticsChannel c) const; // From the latest rising zero crossings, NaN = none
+    double CrossingFrequency(AnalyticsChannel c) const; // From the rising zero crossings, NaN = fewer than two
+    double Thd(AnalyticsChannel c) const; // Harmonics 2..H over the fundamental
+
+    void WriteSummary(std::ostream& out) const; // Compact JSON
+    bool WriteSummary(const std::string& filename) const; // "-" = stdout
+};
+
+#endif // _WAVEFORMANALYTICSH
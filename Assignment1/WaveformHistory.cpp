@@ -0,0 +1,235 @@
+// WaveformHistory.cpp - Bounded, compact waveform storage for drawing and analysis
+
+#include "WaveformHistory.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+WaveformHistory::WaveformHistory(int channels, RetentionPolicy retention, size_t maxSamples, bool useFloat)
+    : channelCount(channels), policy(RETAIN_ALL), capacity(0), compact(false), count(0), implicitTime(true),
+    start(0.0), step(0.0), fineStart(0.0), coarse(0), stride(1), openFill(0), appended(0), dropped(0) {
+    Configure(retention, maxSamples, useFloat);
+}
+
+//------------------------------------------------------------------------------
+bool WaveformHistory::Configure(RetentionPolicy retention, size_t maxSamples, bool useFloat, const string& spillFile) {
+    policy = retention;
+    // Ring and spill drop capacity samples at a time; decimate needs room for its two parts
+    capacity = (policy == RETAIN_ALL) ? 0 : max<size_t>(8, maxSamples);
+    compact = useFloat;
+    spillName = spillFile.empty() ? string("History.bin") : spillFile;
+    if (spill.is_open()) spill.close();
+    Clear();
+    return policy != RETAIN_SPILL || spill.is_open();
+}
+
+//------------------------------------------------------------------------------
+void WaveformHistory::Clear() {
+    values.assign(compact ? 0 : channelCount, vector<double>());
+    compactValues.assign(compact ? channelCount : 0, vector<float>());
+    envelopes.assign(channelCount, EnvelopePyramid());
+    count = 0;
+    implicitTime = true;
+    start = step = fineStart = 0.0;
+    times.clear();
+    coarse = 0;
+    stride = 1;
+    openFill = 0;
+    appended = 0;
+    dropped = 0;
+    if (policy == RETAIN_SPILL) {
+        if (spill.is_open()) spill.close();
+        spill.open(spillName, ios::binary | ios::trunc);
+    }
+}
+
+//------------------------------------------------------------------------------
+// The first two samples fix the time base. Every later time is checked
+// against the grid itself (fineStart + j * step), so small deviations cannot add up;
+// the tolerance, relative to t, only covers the rounding of a clock that
+// accumulates a fixed step.
+void WaveformHistory::StoreTime(double t) {
+    if (implicitTime) {
+        if (count == 0) {
+            start = fineStart = t;
+            return;
+        }
+        if (count == 1 && t > start) {
+            step = t - start;
+            return;
+        }
+        if (count > 1 && fabs(t - (fineStart + double(count - coarse) * step)) <= 1e-9 * (fabs(t) + step)) return;
+
+        times.resize(count);
+        for (size_t i = 0; i < count; ++i) times[i] = Time(i);
+        implicitTime = false;
+    }
+    times.push_back(t);
+}
+
+//------------------------------------------------------------------------------
+void WaveformHistory::Append(double time, const double* sample) {
+    appended++;
+    StoreTime(time);
+    for (int k = 0; k < channelCount; ++k) {
+        if (compact) compactValues[k].push_back(static_cast<float>(sample[k]));
+        else values[k].push_back(sample[k]);
+        envelopes[k].Append(sample[k]);
+    }
+    count++;
+
+    if (capacity == 0) return;
+    if ((policy == RETAIN_RING || policy == RETAIN_SPILL) && count >= 2 * capacity) {
+        Discard(count - capacity);
+        Rebuild();
+    }
+    else if (policy == RETAIN_DECIMATE && count >= capacity) {
+        Decimate();
+        Rebuild();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Spilled rows are the time as a double, then each value as stored
+void WaveformHistory::Discard(size_t n) {
+    if (policy == RETAIN_SPILL && spill.is_open()) {
+        for (size_t i = 0; i < n; ++i) {
+            double t = Time(i);
+            spill.write(reinterpret_cast<const char*>(&t), sizeof(t));
+            for (int k = 0; k < channelCount; ++k) {
+                if (compact) spill.write(reinterpret_cast<const char*>(&compactValues[k][i]), sizeof(float));
+                else spill.write(reinterpret_cast<const char*>(&values[k][i]), sizeof(double));
+            }
+        }
+    }
+    for (auto& v : values) v.erase(v.begin(), v.begin() + n);
+    for (auto& v : compactValues) v.erase(v.begin(), v.begin() + n);
+    if (implicitTime) start = fineStart += double(n) * step;
+    else times.erase(times.begin(), times.begin() + n);
+    count -= n;
+    dropped += n;
+}
+
+//------------------------------------------------------------------------------
+// Inputs go into the open coarse sample until it holds stride of them; the
+// full-resolution samples that remain move down behind the coarse part
+void WaveformHistory::Decimate() {
+    size_t recent = capacity / 4, end = count - recent;
+    double nextFine = Time(end);
+    size_t filled = coarse;
+    for (size_t i = coarse; i < end; ++i) {
+        if (filled == 0 || openFill >= stride) {
+            MoveSample(i, filled++);
+            openFill = 1;
+        }
+        else {
+            MergeSample(i, filled - 1);
+            openFill++;
+        }
+    }
+    // An odd sample out stays open at the doubled stride
+    while (filled > capacity / 2) {
+        size_t kept = (filled + 1) / 2;
+        for (size_t j = 0; j < kept; ++j) {
+            MoveSample(2 * j, j);
+            if (2 * j + 1 < filled) MergeSample(2 * j + 1, j);
+        }
+        if (filled % 2 == 0) openFill += stride;
+        stride *= 2;
+        filled = kept;
+    }
+    for (size_t i = end; i < count; ++i) MoveSample(i, filled + i - end);
+
+    coarse = filled;
+    count = coarse + recent;
+    for (auto& v : values) v.resize(count);
+    for (auto& v : compactValues) v.resize(count);
+    if (!implicitTime) times.resize(count);
+    fineStart = nextFine;
+}
+
+//------------------------------------------------------------------------------
+void WaveformHistory::MoveSample(size_t from, size_t to) {
+    if (from == to) return;
+    for (auto& v : values) v[to] = v[from];
+    for (auto& v : compactValues) v[to] = v[from];
+    if (!implicitTime) times[to] = times[from];
+}
+
+//------------------------------------------------------------------------------
+void WaveformHistory::MergeSample(size_t from, size_t into) {
+    for (auto& v : values)
+        if (fabs(v[from]) > fabs(v[into])) v[into] = v[from];
+    for (auto& v : compactValues)
+        if (fabs(v[from]) > fabs(v[into])) v[into] = v[from];
+}
+
+//------------------------------------------------------------------------------
+void WaveformHistory::Rebuild() {
+    for (int k = 0; k < channelCount; ++k) {
+        envelopes[k].Clear();
+        for (size_t i = 0; i < count; ++i) envelopes[k].Append(Value(k, i));
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t WaveformHistory::IndexAt(double t) const {
+    if (!implicitTime) return lower_bound(times.begin(), times.end(), t) - times.begin();
+    if (count == 0 || t <= start) return 0;
+    if (step <= 0.0) return count;
+    if (coarse > 0) {
+        double index = ceil((t - start) / (double(stride) * step) - 1e-9);
+        if (index < double(coarse)) return static_cast<size_t>(index);
+    }
+    double index = double(coarse) + max(0.0, ceil((t - fineStart) / step - 1e-9));
+    return index >= double(count) ? count : static_cast<size_t>(index);
+}
+
+//------------------------------------------------------------------------------
+size_t WaveformHistory::MemoryBytes() const {
+    size_t bytes = times.capacity() * sizeof(double);
+    for (auto& v : values) bytes += v.capacity() * sizeof(double);
+    for (auto& v : compactValues) bytes += v.capacity() * sizeof(float);
+    for (auto& e : envelopes) bytes += e.MemoryBytes();
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+// Find each column's sample range from the time base, then ask the pyramid for its extremes
+size_t WaveformHistory::Columns(int channel, double tStart, double tEnd, int columns,
+    vector<float>& columnsOut, vector<double>& valuesOut) const {
+    size_t produced = 0;
+    if (count == 0 || columns <= 0 || tEnd <= tStart) return 0;
+
+    const EnvelopePyramid& pyramid = envelopes[channel];
+    double perColumn = (tEnd - tStart) / columns;
+    size_t begin = IndexAt(tStart);
+    for (int col = 0; col < columns && begin < count; ++col) {
+        size_t end = (col + 1 == columns) ? count : max(begin, IndexAt(tStart + (col + 1) * perColumn));
+        if (end <= begin) continue;
+
+        float x = col + 0.5f;
+        if (end - begin == 1) {
+            columnsOut.push_back(x);
+            valuesOut.push_back(Value(channel, begin));
+            produced++;
+        }
+        else {
+            double lo, hi;
+            if (compact) pyramid.Range(compactValues[channel].data(), begin, end, lo, hi);
+            else pyramid.Range(values[channel].data(), begin, end, lo, hi);
+            // Order the pair so the strip follows the waveform's direction
+            bool rising = Value(channel, end - 1) >= Value(channel, begin);
+            columnsOut.push_back(x);
+            valuesOut.push_back(rising ? lo : hi);
+            columnsOut.push_back(x);
+            valuesOut.push_back(rising ? hi : lo);
+            produced += 2;
+        }
+        begin = end;
+    }
+    return produced;
+}
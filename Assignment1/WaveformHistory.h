@@ -0,0 +1,104 @@
+#ifndef _WAVEFORMHISTORYH
+#define _WAVEFORMHISTORYH
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "EnvelopePyramid.h" // Min/max summaries for drawing
+
+// What happens once the history holds its capacity of samples
+enum RetentionPolicy {
+    RETAIN_ALL,      // Keep everything (no limit)
+    RETAIN_RING,     // Keep the most recent samples, drop the oldest
+    RETAIN_DECIMATE, // Keep the whole run, merging older samples to coarser resolution
+    RETAIN_SPILL     // Keep the most recent samples, append the oldest to a file
+};
+
+// In-memory waveform history: a time base plus one value per channel for
+// every stored sample, with a min/max pyramid per channel for drawing.
+//
+// Memory is bounded by the retention policy. Ring and spill keep between
+// capacity and 2 * capacity samples: once 2 * capacity are held, the oldest
+// capacity are dropped (or written out) in one block, so the cost is
+// amortised and the arrays stay contiguous. Decimate keeps the newest
+// capacity / 4 samples at full resolution and the older part of the run as
+// coarse samples, each merging stride consecutive inputs into the one with
+// the largest |value| (per channel), so peaks and MaxAbs survive any number
+// of merges. Whenever capacity is reached, the full-resolution samples older
+// than that window are merged into the coarse part, which is halved (pairs
+// merged the same way, stride doubled) while it holds more than capacity / 2.
+// The last coarse sample may still be filling (openFill inputs so far).
+//
+// Encoding: fixed-step runs store no times at all (coarse sample i is at
+// start + i * stride * step, full-resolution ones follow fineStart at step);
+// the first time that is off that grid by more than clock rounding (1e-9
+// relative) switches to explicit double times, so a reconstructed time is
+// never further off than that. A coarse sample carries the time of its
+// first input. Values are doubles, or float32 when compact.
+class WaveformHistory {
+    int channelCount; // Values per sample
+    RetentionPolicy policy; // What to do when full
+    size_t capacity; // Samples kept in memory before the policy acts
+    bool compact; // Store values as float32
+    std::vector<std::vector<double>> values; // values[channel][i], when !compact
+    std::vector<std::vector<float>> compactValues; // values[channel][i], when compact
+    std::vector<EnvelopePyramid> envelopes; // One per channel, over the stored samples
+    size_t count; // Samples stored
+
+    bool implicitTime; // Times follow start + i * stride * step, then fineStart + j * step
+    double start, step; // Time of the first stored sample and the input step
+    double fineStart; // Time of the first full-resolution sample
+    std::vector<double> times; // Explicit times once the steps became irregular
+
+    size_t coarse; // Leading stored samples that merge stride inputs each (decimate)
+    size_t stride; // Inputs per coarse sample
+    size_t openFill; // Inputs merged into the last coarse sample so far
+    size_t appended; // Samples offered to Append()
+    size_t dropped; // Stored samples discarded or spilled
+    std::string spillName; // Spill file name
+    std::ofstream spill; // Spill file, binary rows of time then values
+
+    void StoreTime(double t); // Extend the time base with t
+    void Discard(size_t n); // Drop (or spill) the oldest n stored samples
+    void Decimate(); // Merge older samples into the coarse part
+    void MoveSample(size_t from, size_t to); // Copy a stored sample to a lower index
+    void MergeSample(size_t from, size_t into); // Keep the larger |value| of each channel in into
+    void Rebuild(); // Recompute the pyramids from the stored samples
+
+public:
+    WaveformHistory(int channels, RetentionPolicy policy = RETAIN_ALL, size_t capacity = 0, bool compact = false);
+
+    // Change the policy and clear; spillFile is used by RETAIN_SPILL, false if it cannot be opened
+    bool Configure(RetentionPolicy policy, size_t capacity, bool compact, const std::string& spillFile = "");
+    void Clear(); // Forget every sample (the spill file is restarted)
+
+    void Append(double time, const double* sample); // One value per channel
+
+    // Consumer side
+    size_t Size() const { return count; } // Samples in memory
+    int Channels() const { return channelCount; }
+    double Time(size_t i) const {
+        if (!implicitTime) return times[i];
+        return i < coarse ? start + double(i) * double(stride) * step : fineStart + double(i - coarse) * step;
+    }
+    double Value(int channel, size_t i) const {
+        return compact ? double(compactValues[channel][i]) : values[channel][i];
+    }
+    double MaxAbs(int channel) const { return envelopes[channel].MaxAbs(); } // Over the stored samples
+    size_t IndexAt(double t) const; // First stored sample at or after t
+    size_t Appended() const { return appended; }
+    size_t Dropped() const { return dropped; } // Discarded by the ring or written to the spill file
+    size_t Merged() const { return appended - dropped - count; } // Inputs folded into coarse samples of another input
+    size_t Stride() const { return stride; } // Inputs per coarse sample so far
+    bool ImplicitTime() const { return implicitTime; }
+    size_t MemoryBytes() const; // Heap held by samples, times and pyramids
+
+    // Reduce channel to at most two vertices per pixel column (its min and max
+    // in that column) for drawing. Columns cover [tStart, tEnd]; each vertex
+    // is (column + 0.5, value). Returns the number of vertices appended.
+    size_t Columns(int channel, double tStart, double tEnd, int columns,
+        std::vector<float>& columnsOut, std::vector<double>& valuesOut) const;
+};
+
+#endif // _WAVEFORMHISTORYH